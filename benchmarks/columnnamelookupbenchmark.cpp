@@ -0,0 +1,151 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+/// Compares looking up names with ColumnEncoder to the std::map<std::string, std::string> it used to keep per direction, for 1k, 10k and 100k columns.
+/// Both get the same names, typed ones included, and are timed on the same lookups. Memory is whatever got allocated while building them.
+///
+/// It is not part of the library, build it against the sources in the directory above just like jasp-desktop does, for instance:
+///   g++ -std=c++17 -O2 -DBUILDING_JASP -I.. -I<where log.h is> columnnamelookupbenchmark.cpp $(ls ../*.cpp | grep -v utils.cpp) ../json/*.cpp -lpthread
+
+#include "columnencoder.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+static size_t _allocated = 0; ///< Bytes, only counts, never subtracts
+
+void * operator new(size_t size)
+{
+	_allocated += size;
+
+	if(void * memory = std::malloc(size))
+		return memory;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void * memory)					noexcept { std::free(memory); }
+void operator delete(void * memory, size_t)			noexcept { std::free(memory); }
+
+typedef std::map<std::string, std::string>	colMap;
+typedef std::vector<std::string>			colVec;
+typedef std::chrono::steady_clock			clk;
+
+static double msSince(clk::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clk::now() - start).count();
+}
+
+static const colVec & typeSuffixes()
+{
+	static const colVec suffixes = { ".scale", ".ordinal", ".nominal" };
+	return suffixes;
+}
+
+///The same names as setCurrentNames with types, the way the maps used to be filled.
+static void fillMaps(const colVec & names, colMap & encoding, colMap & decoding)
+{
+	for(size_t col = 0; col < names.size(); col++)
+	{
+		std::string encoded = "JaspColumn_" + std::to_string(col) + "_Encoded";
+
+		encoding[names[col]]	= encoded;
+		decoding[encoded]		= names[col];
+
+		for(size_t typeIndex = 0; typeIndex < 3; typeIndex++)
+		{
+			std::string encodedTyped = "JaspColumn_" + std::to_string(names.size() + 3 * col + typeIndex) + "_Encoded";
+
+			encoding[names[col] + typeSuffixes()[typeIndex]]	= encodedTyped;
+			decoding[encodedTyped]								= names[col];
+		}
+	}
+}
+
+static void benchmark(size_t columns, size_t lookups)
+{
+	std::mt19937	random(columns);
+	colVec			names,
+					lookFor,
+					encodedNames;
+
+	for(size_t col = 0; col < columns; col++)
+		names.push_back("Column " + std::to_string(random() % 1000000) + "_" + std::to_string(col));
+
+	for(size_t i = 0; i < lookups; i++)
+		lookFor.push_back(names[random() % columns] + (i % 4 == 0 ? "" : typeSuffixes()[i % 3]));
+
+	colMap	encodingMap,
+			decodingMap;
+
+	size_t				allocatedBefore	= _allocated;
+	clk::time_point		start			= clk::now();
+
+	fillMaps(names, encodingMap, decodingMap);
+
+	double	mapBuild	= msSince(start);
+	size_t	mapBytes	= _allocated - allocatedBefore;
+
+	allocatedBefore	= _allocated;
+	start			= clk::now();
+
+	ColumnEncoder::setCurrentColumnNames(names);
+
+	double	indexBuild	= msSince(start);
+	size_t	indexBytes	= _allocated - allocatedBefore;
+
+	size_t found = 0;
+	start = clk::now();
+
+	for(const std::string & name : lookFor)
+	{
+		auto encoded = encodingMap.find(name);
+
+		if(encoded != encodingMap.end())
+		{
+			encodedNames.push_back(encoded->second);
+			found += decodingMap.count(encoded->second);
+		}
+	}
+
+	double mapLookups = msSince(start);
+	start = clk::now();
+
+	for(size_t i = 0; i < lookFor.size(); i++)
+	{
+		std::string encoded = ColumnEncoder::columnEncoder()->encode(lookFor[i]);
+		found += ColumnEncoder::isEncodedColumnName(encoded) && encoded == encodedNames[i];
+	}
+
+	double indexLookups = msSince(start);
+
+	if(found != 2 * lookups)
+		std::printf("Not every name was found, the results mean nothing!\n");
+
+	std::printf("%7zu columns    build: map %8.2f ms, index %8.2f ms    memory: map %9.2f MB, index %9.2f MB    en- and decoding %zu names: map %8.2f ms, index %8.2f ms\n",
+		columns, mapBuild, indexBuild, mapBytes / 1e6, indexBytes / 1e6, lookups, mapLookups, indexLookups);
+}
+
+int main()
+{
+	for(size_t columns : { 1000, 10000, 100000 })
+		benchmark(columns, 1000000);
+
+	return 0;
+}
@@ -0,0 +1,101 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+/// Times ColumnEncoder::encodeColumnNamesinOptions on option objects with more and more members that should be encoded but have no meta of their own.
+/// The whole object is encoded once however many of those members it has, so the time per member should stay about the same however big the object gets.
+/// For comparison it also times what it used to do for the smaller ones: encode the whole object again for every such member.
+///
+/// It is not part of the library, build it against the sources in the directory above just like jasp-desktop does, for instance:
+///   g++ -std=c++17 -O2 -DBUILDING_JASP -I.. -I<where log.h is> optionsencodingbenchmark.cpp $(ls ../*.cpp | grep -v utils.cpp) ../json/*.cpp -lpthread
+
+#include "columnencoder.h"
+#include <chrono>
+#include <cstdio>
+
+typedef std::chrono::steady_clock clk;
+
+static double msSince(clk::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clk::now() - start).count();
+}
+
+static Json::Value optionsWithMembers(size_t members, size_t columns)
+{
+	Json::Value options(Json::objectValue);
+
+	options[".meta"]["shouldEncode"] = true;
+
+	for(size_t member = 0; member < members; member++)
+	{
+		std::string name = "option" + std::to_string(member);
+
+		if(member % 2 == 0)
+			options[name] = "column_" + std::to_string(member % columns);
+		else
+		{
+			options[name] = Json::Value(Json::arrayValue);
+			options[name].append("column_" + std::to_string(member % columns));
+			options[name].append("not a column");
+		}
+	}
+
+	return options;
+}
+
+int main()
+{
+	const size_t				columns = 1000;
+	std::vector<std::string>	names;
+
+	for(size_t col = 0; col < columns; col++)
+		names.push_back("column_" + std::to_string(col));
+
+	ColumnEncoder::setCurrentColumnNames(names);
+	ColumnEncoder::snapshot()->encodingMatcher(); //Building it isn't what this is about
+
+	for(size_t members : { 1000, 2000, 4000, 8000, 100000 })
+	{
+		Json::Value			options	= optionsWithMembers(members, columns);
+		clk::time_point		start	= clk::now();
+
+		ColumnEncoder::encodeColumnNamesinOptions(options, false);
+
+		double now = msSince(start);
+
+		if(options["option0"].asString() == "column_0")
+			std::printf("Nothing got encoded, the results mean nothing!\n");
+
+		std::printf("%7zu members: %9.2f ms, %6.3f us per member", members, now, 1000 * now / members);
+
+		if(members <= 8000)
+		{
+			options	= optionsWithMembers(members, columns);
+			start	= clk::now();
+
+			for(size_t member = 0; member < members; member++)
+				ColumnEncoder::encodeJson(options, false, true);
+
+			double before = msSince(start);
+
+			std::printf("    whole object per member: %9.2f ms, %8.3f us per member", before, 1000 * before / members);
+		}
+
+		std::printf("\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,185 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef BINARYSERIALIZATION_H
+#define BINARYSERIALIZATION_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+/// Writes plain values, strings and vectors of plain values one after the other as raw bytes, with the size in front of the latter two.
+/// It is meant for handing state to another process of the same build on the same machine, so there is no conversion of byte order or anything like that.
+/// Vectors start at a multiple of 8 bytes from the beginning, so if that is aligned (as a memory-mapped file is) they can be used right where they are.
+class BinaryWriter
+{
+public:
+								BinaryWriter(std::string & out) : _out(out), _start(out.size()) {}
+
+			template<typename T>
+			void				write(const T & value)
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written as raw bytes");
+				_out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+			}
+
+			void				write(std::string_view text)
+			{
+				write(uint64_t(text.size()));
+				_out.append(text);
+			}
+
+			void				write(const std::string & text) { write(std::string_view(text)); }
+
+			template<typename T>
+			void				write(const std::vector<T> & values) { write(values.data(), values.size()); }
+
+			template<typename T>
+			void				write(const T * values, size_t count)
+			{
+				startArray<T>(count);
+				appendToArray(values, count);
+			}
+
+			///For values that are not in one piece: start with how many there are in total and then append the pieces in order, that comes out the same as write(values, count).
+			template<typename T>
+			void				startArray(size_t count)
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "Only vectors of plain values can be written as raw bytes");
+				align();
+				write(uint64_t(count));
+			}
+
+			template<typename T>
+			void				appendToArray(const T * values, size_t count)
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "Only vectors of plain values can be written as raw bytes");
+
+				if(count > 0)
+					_out.append(reinterpret_cast<const char *>(values), count * sizeof(T));
+			}
+
+private:
+			void				align() { _out.append((8 - (_out.size() - _start) % 8) % 8, '\0'); }
+
+	std::string &	_out;
+	const size_t	_start;
+};
+
+/// Reads back what BinaryWriter wrote, straight from the bytes (a memory-mapped file for instance) with a memcpy per vector or string.
+/// Every read checks whether there is enough left, if not it returns false and the reader should be considered broken.
+/// Memcpy is used because the data in a buffer or file does not have to be aligned.
+/// The view functions do not copy anything but point into the data, that only works if the data is aligned and stays around.
+class BinaryReader
+{
+public:
+								BinaryReader(std::string_view data) : _data(data), _size(data.size()) {}
+
+			template<typename T>
+			bool				read(T & value)
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read as raw bytes");
+
+				if(_data.size() < sizeof(T))
+					return false;
+
+				std::memcpy(&value, _data.data(), sizeof(T));
+				_data.remove_prefix(sizeof(T));
+				return true;
+			}
+
+			bool				read(std::string & text)
+			{
+				uint64_t size;
+
+				if(!read(size) || _data.size() < size)
+					return false;
+
+				text.assign(_data.data(), size);
+				_data.remove_prefix(size);
+				return true;
+			}
+
+			template<typename T>
+			bool				read(std::vector<T> & values)
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "Only vectors of plain values can be read as raw bytes");
+
+				uint64_t size;
+
+				if(!align() || !read(size) || _data.size() / sizeof(T) < size)
+					return false;
+
+				values.resize(size);
+
+				if(size > 0) //An empty vector might not have any data to copy to
+					std::memcpy(values.data(), _data.data(), size * sizeof(T));
+
+				_data.remove_prefix(size * sizeof(T));
+				return true;
+			}
+
+			bool				view(std::string_view & text)
+			{
+				uint64_t size;
+
+				if(!read(size) || _data.size() < size)
+					return false;
+
+				text = _data.substr(0, size);
+				_data.remove_prefix(size);
+				return true;
+			}
+
+			template<typename T>
+			bool				view(const T *& values, size_t & count)
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "Only vectors of plain values can be viewed as raw bytes");
+
+				uint64_t size;
+
+				if(!align() || !read(size) || _data.size() / sizeof(T) < size || reinterpret_cast<uintptr_t>(_data.data()) % alignof(T) != 0)
+					return false;
+
+				values	= reinterpret_cast<const T *>(_data.data());
+				count	= size;
+				_data.remove_prefix(size * sizeof(T));
+				return true;
+			}
+
+			bool				atEnd() const { return _data.empty(); }
+
+private:
+			bool				align()
+			{
+				size_t padding = (8 - (_size - _data.size()) % 8) % 8;
+
+				if(_data.size() < padding)
+					return false;
+
+				_data.remove_prefix(padding);
+				return true;
+			}
+
+	std::string_view	_data;
+	const size_t		_size; ///< Of all data, to know how far we got
+};
+
+#endif // BINARYSERIALIZATION_H
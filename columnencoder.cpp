@@ -17,7 +17,6 @@
 
 #include "columnencoder.h"
 #include "stringutils.h"
-#include <regex>
 #ifdef BUILDING_JASP
 #include "log.h"
 #define LOGGER Log::log()
@@ -30,59 +29,110 @@
 
 ColumnEncoder				*	ColumnEncoder::_columnEncoder				= nullptr;
 std::set<ColumnEncoder*>	*	ColumnEncoder::_otherEncoders				= nullptr;
-bool							ColumnEncoder::_encodingMapInvalidated		= true;
-bool							ColumnEncoder::_decodingMapInvalidated		= true;
-bool							ColumnEncoder::_decodingTypeInvalidated		= true;
-bool							ColumnEncoder::_decoSafeMapInvalidated		= true;
-bool							ColumnEncoder::_originalNamesInvalidated	= true;
-bool							ColumnEncoder::_encodedNamesInvalidated		= true;
+size_t							ColumnEncoder::_generation					= 0;
+ColumnEncoderSnapshot::Ptr		ColumnEncoder::_snapshot					= std::make_shared<const ColumnEncoderSnapshot>(nullptr, std::vector<ColumnEncoding::Ptr>(), 0);
+const size_t					ColumnEncoder::_encodedRScriptsMax			= 256;
+std::mutex						ColumnEncoder::_encodedRScriptsLock;
+ColumnEncoder::EncodedRScripts		ColumnEncoder::_encodedRScripts;
+ColumnEncoder::EncodedRScriptsIndex	ColumnEncoder::_encodedRScriptsIndex;
 
 
 ColumnEncoder * ColumnEncoder::columnEncoder()
 {
 	if(!_columnEncoder)
+	{
 		_columnEncoder = new ColumnEncoder();
+		invalidateAll();
+	}
 
 	return _columnEncoder;
 }
 
-void ColumnEncoder::invalidateAll()
+ColumnEncoderSnapshot::Ptr ColumnEncoder::snapshot()
+{
+	return std::atomic_load(&_snapshot);
+}
+
+void ColumnEncoder::invalidateAll(const ColumnEncoderSnapshot::Changes * changes)
+{
+	std::vector<ColumnEncoding::Ptr>	others;
+	ColumnEncoding::Ptr					global = _columnEncoder ? std::atomic_load(&_columnEncoder->_encoding) : nullptr;
+
+	if(_otherEncoders)
+		for(const ColumnEncoder * other : *_otherEncoders)
+			others.push_back(std::atomic_load(&other->_encoding));
+
+	//Whoever is still en- or decoding with the previous one just finishes with that, it goes away when the last of them lets go of it.
+	//If we know what changed the new one only has to build matchers for that, on top of those of the previous one.
+	if(changes)	std::atomic_store(&_snapshot, std::make_shared<const ColumnEncoderSnapshot>(*snapshot(), *changes, global, std::move(others), ++_generation));
+	else		std::atomic_store(&_snapshot, std::make_shared<const ColumnEncoderSnapshot>(global, std::move(others), ++_generation));
+
+	std::lock_guard<std::mutex> lock(_encodedRScriptsLock);
+
+	_encodedRScripts		.clear();
+	_encodedRScriptsIndex	.clear();
+}
+
+std::shared_ptr<ColumnEncoding> ColumnEncoder::copyOfEncoding() const
 {
-	_encodingMapInvalidated		= true;
-	_decodingMapInvalidated		= true;
-	_decodingTypeInvalidated	= true;
-	_decoSafeMapInvalidated		= true;
-	_originalNamesInvalidated	= true;
-	_encodedNamesInvalidated	= true;
+	return std::make_shared<ColumnEncoding>(*std::atomic_load(&_encoding));
 }
 
-ColumnEncoder::ColumnEncoder(std::string prefix, std::string postfix)
-	: _encodePrefix(prefix), _encodePostfix(postfix)
+void ColumnEncoder::setEncoding(ColumnEncoding::Ptr encoding, const ColumnEncoderSnapshot::Changes * changes)
 {
+	std::atomic_store(&_encoding, encoding);
+
+	if(_scope == encoderScope::shared)
+		invalidateAll(changes);
+}
+
+ColumnEncoderSnapshot::Ptr ColumnEncoder::withGlobal() const
+{
+	ColumnEncoderSnapshot::Ptr	global		= snapshot(),
+								combined	= std::atomic_load(&_withGlobal);
+	ColumnEncoding::Ptr			encoding	= std::atomic_load(&_encoding);
+
+	//Every new snapshot gets a new generation, so if that and our own encoding are still the same so is the combination
+	if(combined && combined->generation() == global->generation() && combined->extra() == encoding)
+		return combined;
+
+	combined = std::make_shared<const ColumnEncoderSnapshot>(*global, encoding);
+	std::atomic_store(&_withGlobal, combined);
+
+	return combined;
+}
+
+ColumnEncoder::ColumnEncoder()
+	: _encoding(std::make_shared<ColumnEncoding>("JaspColumn_", "_Encoded"))
+{}
+
+ColumnEncoder::ColumnEncoder(std::string prefix, std::string postfix, encoderScope scope)
+	: _encoding(std::make_shared<ColumnEncoding>(prefix, postfix)), _scope(scope)
+{
+	if(_scope == encoderScope::scoped)
+		return;
+
 	if(!_otherEncoders)
-	{
 		_otherEncoders = new ColumnEncoder::ColumnEncoders();
-		invalidateAll();
-	}
 
-	_otherEncoders->insert(this);
+	_otherEncoders->insert(this); //It has no names yet, so nothing changes until it gets some
 }
 
 ColumnEncoder::ColumnEncoder(const std::map<std::string, std::string> & decodeDifferently)
-	: _encodePrefix("JASPColumn_"), _encodePostfix("_For_Replacement")
 {
-
 	std::vector<std::string> originalNames;
 	originalNames.reserve(decodeDifferently.size());
 
 	for(const auto & oriNew : decodeDifferently)
 		originalNames.push_back(oriNew.first);
 
-	setCurrentNames(originalNames);
+	//It isn't one of the _otherEncoders, so nobody else needs to know about it
+	std::shared_ptr<ColumnEncoding> encoding = std::make_shared<ColumnEncoding>("JASPColumn_", "_For_Replacement");
+
+	encoding->setNames(originalNames, true);
+	encoding->decodeDifferently(decodeDifferently);
 
-	for(const std::string & encodedName : _encodedNames)
-		if(decodeDifferently.count(_decodingMap[encodedName]) > 0)
-			_decodingMap[encodedName] = decodeDifferently.at(_decodingMap[encodedName]);
+	_encoding = encoding;
 }
 
 ColumnEncoder::~ColumnEncoder()
@@ -90,7 +140,12 @@ ColumnEncoder::~ColumnEncoder()
 	if(this != _columnEncoder)
 	{
 		if(_otherEncoders && _otherEncoders->count(this) > 0) //The special "replacer-encoder" doesn't add itself to otherEncoders.
+		{
 			_otherEncoders->erase(this);
+
+			if(!_encoding->empty()) //The current snapshot still has its names
+				invalidateAll();
+		}
 	}
 	else
 	{
@@ -115,392 +170,365 @@ std::string ColumnEncoder::encode(const std::string &in)
 {
 	if(in == "") return "";
 
-	if(encodingMap().count(in) == 0)
+	std::string encoded;
+
+	if(!lookupSnapshot()->encode(in, encoded))
 		throw std::runtime_error("Trying to encode columnName but '" + in + "' is not a columnName!");
 
-	return encodingMap().at(in);
+	return encoded;
 }
 
 std::string ColumnEncoder::decode(const std::string &in)
 {
 	if(in == "") return "";
 
-	if(decodingMap().count(in) == 0)
-		throw std::runtime_error("Trying to decode columnName but '" + in + "' is not an encoded columnName!");
+	ColumnEncoderSnapshot::Ptr	names = lookupSnapshot();
+	std::string_view			decoded;
 
-	return decodingMap().at(in);
-}
+	if(!names->decode(in, decoded))
+		throw std::runtime_error("Trying to decode columnName but '" + in + "' is not an encoded columnName!");
 
-columnType ColumnEncoder::columnTypeFromEncoded(const std::string &in)
-{
-	if(in == "" || decodingTypes().count(in) == 0) 
-		return columnType::unknown;
-	
-	return decodingTypes().at(in);
+	return std::string(decoded);
 }
 
-void ColumnEncoder::setCurrentNames(const std::vector<std::string> & names, bool generateTypesEncoding)
+template<typename Names>
+void ColumnEncoder::lookupAll(const ColumnEncoderSnapshot & names, const Names & in, colVec & out, std::vector<bool> * found, bool encoding)
 {
-	//LOGGER << "ColumnEncoder::setCurrentNames(#"<< names.size() << ")" << std::endl;
-
-	_encodingMap.clear();
-	_decodingMap.clear();
+	out.resize(in.size());
 
-	_encodedNames.clear();
-	_encodedNames.reserve(names.size());
-	
-	size_t runningCounter = 0;
-	
-	_originalNames = names;
+	if(found)
+		found->assign(in.size(), true);
 
-	//First normal encoding decoding: (Although im not sure we would ever need those again?)
-	for(size_t col = 0; col < names.size(); col++)
+	for(size_t i=0; i<in.size(); i++)
 	{
-		std::string newName			= _encodePrefix + std::to_string(runningCounter++) + _encodePostfix; //Slightly weird (but R-syntactically valid) name to avoid collisions with user stuff.
-		_encodingMap[names[col]]	= newName;
-		_decodingMap[newName]		= names[col];
+		std::string_view	name	= in[i],
+							decoded;
+		bool				success	= encoding ? names.encode(name, out[i]) : names.decode(name, decoded);
 
-		_encodedNames.push_back(newName);
+		if(success && !encoding)
+			out[i] = decoded;
+		else if(!success)
+		{
+			out[i] = name;
+
+			if(found && !name.empty()) //Just like encode and decode we consider "" to be fine
+				(*found)[i] = false;
+		}
 	}
-	
-	if(generateTypesEncoding)
-		for(size_t col = 0; col < names.size(); col++)
-			for(columnType colType : { columnType::scale, columnType::ordinal, columnType::nominal })
-				{
-					std::string qualifiedName	= names[col] + "." + columnTypeToString(colType),
-								newName			= _encodePrefix + std::to_string(runningCounter++) + _encodePostfix; //Slightly weird (but R-syntactically valid) name to avoid collisions with user stuff.
-					_encodingMap[qualifiedName]	= newName;
-					_decodingMap[newName]		= names[col]; //Decoding is back to the actual name in the data!
-					_decodingTypes[newName]		= colType;
-			
-					_encodedNames	.push_back(newName);
-					_originalNames	.push_back(qualifiedName);
-				}
+}
 
-	
-	sortVectorBigToSmall(_originalNames);
-	invalidateAll();
+void ColumnEncoder::encode(const colVec & in, colVec & out, std::vector<bool> * found)
+{
+	lookupAll(*lookupSnapshot(), in, out, found, true); //The whole batch with the same names
 }
 
-void ColumnEncoder::sortVectorBigToSmall(std::vector<std::string> & vec)
+void ColumnEncoder::encode(const colViews & in, colVec & out, std::vector<bool> * found)
 {
-	std::sort(vec.begin(), vec.end(), [](std::string & a, std::string & b) { return a.size() > b.size(); }); //We need this to make sure smaller columnNames do not bite chunks off of larger ones
+	lookupAll(*lookupSnapshot(), in, out, found, true);
 }
 
-const ColumnEncoder::colMap	&	ColumnEncoder::encodingMap()
+void ColumnEncoder::decode(const colVec & in, colVec & out, std::vector<bool> * found)
 {
-	static ColumnEncoder::colMap map;
+	lookupAll(*lookupSnapshot(), in, out, found, false);
+}
 
-	if(_encodingMapInvalidated)
-	{
-		map = _columnEncoder->_encodingMap;
+void ColumnEncoder::decode(const colViews & in, colVec & out, std::vector<bool> * found)
+{
+	lookupAll(*lookupSnapshot(), in, out, found, false);
+}
 
-		if(_otherEncoders)
-			for(const ColumnEncoder * other : *_otherEncoders)
-				for(const auto & keyVal : other->_encodingMap)
-					if(map.count(keyVal.first) == 0)
-						map[keyVal.first] = keyVal.second;
+columnType ColumnEncoder::columnTypeFromEncoded(const std::string &in)
+{
+	columnType			type = columnType::unknown;
+	std::string_view	decoded;
 
-		_encodingMapInvalidated = false;
-	}
+	if(in != "")
+		lookupSnapshot()->decode(in, decoded, &type);
 
-	return map;
+	return type;
 }
 
-const ColumnEncoder::colMap	&	ColumnEncoder::decodingMap()
+void ColumnEncoder::setCurrentNames(const std::vector<std::string> & names, bool generateTypesEncoding)
 {
-	static ColumnEncoder::colMap map;
-
-	if(_decodingMapInvalidated)
-	{
-		map = _columnEncoder->_decodingMap;
-
-		if(_otherEncoders)
-			for(const ColumnEncoder * other : *_otherEncoders)
-				for(const auto & keyVal : other->_decodingMap)
-					if(map.count(keyVal.first) == 0)
-						map[keyVal.first] = keyVal.second;
+	//LOGGER << "ColumnEncoder::setCurrentNames(#"<< names.size() << ")" << std::endl;
 
-		_decodingMapInvalidated = false;
-	}
+	const ColumnEncoding::Ptr	current		= std::atomic_load(&_encoding);
+	auto						encoding	= std::make_shared<ColumnEncoding>(current->prefix(), current->postfix());
 
-	return map;
+	encoding->setNames(names, generateTypesEncoding);
+	setEncoding(encoding);
 }
 
-const ColumnEncoder::colTypeMap &ColumnEncoder::decodingTypes()
+void ColumnEncoder::addColumns(const std::vector<std::string> & names)
 {
-	static ColumnEncoder::colTypeMap map;
+	//Whatever snapshot has the current encoding keeps it as it is, so the changes go in a copy. That shares all but the pages that change, see SharedPages.
+	auto								encoding = copyOfEncoding();
+	ColumnEncoderSnapshot::Changes		changes;
 
-	if(_decodingTypeInvalidated)
-	{
-		map = _columnEncoder->_decodingTypes;
-
-		if(_otherEncoders)
-			for(const ColumnEncoder * other : *_otherEncoders)
-				for(const auto & keyVal : other->_decodingTypes)
-					if(map.count(keyVal.first) == 0)
-						map[keyVal.first] = keyVal.second;
+	encoding->addColumns(names);
 
-		_decodingTypeInvalidated = false;
-	}
+	for(const std::string & name : names)
+		encoding->collectAffected(name, changes.encodingKeys, changes.decodingKeys);
 
-	return map;
+	setEncoding(encoding, &changes);
 }
 
-
-const ColumnEncoder::colMap	&	ColumnEncoder::decodingMapSafeHtml()
+void ColumnEncoder::removeColumns(const std::vector<std::string> & names)
 {
-	static ColumnEncoder::colMap map;
+	auto								encoding = copyOfEncoding();
+	ColumnEncoderSnapshot::Changes		changes;
 
-	if(_decoSafeMapInvalidated)
-	{
-		map.clear();
-		
-		for(const auto & keyVal : _columnEncoder->_decodingMap)
-			if(map.count(keyVal.first) == 0)
-				map[keyVal.first] = stringUtils::escapeHtmlStuff(keyVal.second, true);
+	//Once they are removed the encoding doesn't know what they were encoded to anymore
+	for(const std::string & name : names)
+		encoding->collectAffected(name, changes.encodingKeys, changes.decodingKeys);
 
-		if(_otherEncoders)
-			for(const ColumnEncoder * other : *_otherEncoders)
-				for(const auto & keyVal : other->_decodingMap)
-					if(map.count(keyVal.first) == 0)
-						map[keyVal.first] = stringUtils::escapeHtmlStuff(keyVal.second, true); // replace square brackets for https://github.com/jasp-stats/jasp-issues/issues/2625
+	encoding->removeColumns(names);
+	setEncoding(encoding, &changes);
+}
 
-		_decoSafeMapInvalidated = false;
-	}
+void ColumnEncoder::renameColumn(const std::string & oldName, const std::string & newName)
+{
+	auto								encoding = copyOfEncoding();
+	ColumnEncoderSnapshot::Changes		changes;
+
+	encoding->collectAffected(oldName, changes.encodingKeys, changes.decodingKeys);
+	encoding->renameColumn(oldName, newName);
+	encoding->collectAffected(newName, changes.encodingKeys, changes.decodingKeys);
 
-	return map;
+	setEncoding(encoding, &changes);
 }
 
-const ColumnEncoder::colVec	&	ColumnEncoder::originalNames()
+std::string ColumnEncoder::serializedNames() const
 {
-	static ColumnEncoder::colVec vec;
+	std::string		data;
+	BinaryWriter	writer(data);
 
-	if(_originalNamesInvalidated)
-	{
-		vec = _columnEncoder->_originalNames;
+	std::atomic_load(&_encoding)->write(writer);
 
-		if(_otherEncoders)
-			for(const ColumnEncoder * other : *_otherEncoders)
-				for(const std::string & name : other->_originalNames)
-					vec.push_back(name);
+	return data;
+}
 
-		_originalNamesInvalidated = false;
-	}
+void ColumnEncoder::setSerializedNames(std::string_view data)
+{
+	auto			encoding	= std::make_shared<ColumnEncoding>("", "");
+	BinaryReader	reader(data);
 
-	sortVectorBigToSmall(vec);
+	if(!encoding->read(reader) || !reader.atEnd())
+		throw std::runtime_error("Trying to set serialized columnNames but the data is not something ColumnEncoder::serializedNames made!");
 
-	return vec;
+	setEncoding(encoding);
 }
 
-const ColumnEncoder::colVec	&	ColumnEncoder::encodedNames()
+SharedColumnNames::Ptr ColumnEncoder::publishSharedNames(const std::string & segmentName) const
 {
-	static ColumnEncoder::colVec vec;
+	return SharedColumnNames::publish(segmentName, serializedNames(), snapshot()->generation());
+}
 
-	if(_encodedNamesInvalidated)
-	{
-		vec = _columnEncoder->_encodedNames;
+void ColumnEncoder::setSharedNames(const SharedColumnNames::Ptr & shared)
+{
+	auto			encoding	= std::make_shared<ColumnEncoding>("", "");
+	BinaryReader	reader(shared ? shared->data() : std::string_view());
 
-		if(_otherEncoders)
-			for(const ColumnEncoder * other : *_otherEncoders)
-				for(const std::string & name : other->_encodedNames)
-					vec.push_back(name);
+	if(!shared || !encoding->read(reader, shared) || !reader.atEnd())
+		throw std::runtime_error("Trying to use shared columnNames but '" + (shared ? shared->name() : std::string("nothing")) + "' does not contain any!");
 
-		_encodedNamesInvalidated = false;
-	}
+	setEncoding(encoding);
+}
 
-	sortVectorBigToSmall(vec);
+SortedColumnNames::Ptr ColumnEncoder::sortedColumnNames()
+{
+	ColumnEncoderSnapshot::Ptr names = snapshot();
 
-	return vec;
+	return SortedColumnNames::Ptr(names, &names->sortedColumnNames()); //Shares ownership of the whole snapshot, so it can be held on to for as long as needed
 }
 
 bool ColumnEncoder::shouldEncode(const std::string & in)
 {
-	return _encodingMap.count(in) > 0;
+	std::string encoded;
+	return std::atomic_load(&_encoding)->findEncoded(in, encoded);
 }
 
 bool ColumnEncoder::shouldDecode(const std::string & in)
 {
-	return _decodingMap.count(in) > 0;
+	std::string_view decoded;
+	return std::atomic_load(&_encoding)->findDecoded(in, decoded);
 }
 
-std::string	ColumnEncoder::replaceAllStrict(const std::string & text, const std::map<std::string, std::string> & map)
+std::string ColumnEncoder::encodeRScript(const std::string & text, std::set<std::string> * columnNamesFound)
 {
-	if (map.count(text) > 0)
-		return map.at(text);
-	else
-		return text;
-}
+	if(_scope == encoderScope::scoped) //The cache is only for the shared names
+		return withGlobal()->rScriptEncoder().replace(text, columnNamesFound);
 
-std::string	ColumnEncoder::replaceAll(std::string text, const std::map<std::string, std::string> & map, const std::vector<std::string> & names)
-{
-	size_t foundPos = 0;
+	ColumnEncoderSnapshot::Ptr	names	= snapshot();
+	size_t						hash	= std::hash<std::string>()(text);
 
-	while(foundPos < std::string::npos)
 	{
-		size_t firstFoundPos	= std::string::npos;
+		std::lock_guard<std::mutex> lock(_encodedRScriptsLock);
 
-		std::string replaceThis;
+		auto cached = _encodedRScriptsIndex.equal_range(hash);
 
-		//First we find the first occurence of a replaceable text.
-		for(const std::string & replaceMe : names) //We follow names instead of keyvals from map because they ought to be sorted from largest to smallest string (_originalNames) to not make sub-replacements
+		for(auto hashEntry = cached.first; hashEntry != cached.second; hashEntry++)
 		{
-			size_t pos = text.find(replaceMe, foundPos);
-			if(pos < firstFoundPos)
+			EncodedRScript & entry = *hashEntry->second;
+
+			if(entry.generation == names->generation() && entry.script == text)
 			{
-				firstFoundPos = pos;
-				replaceThis = replaceMe;
-			}
-		}
+				_encodedRScripts.splice(_encodedRScripts.begin(), _encodedRScripts, hashEntry->second); //Iterators stay valid
 
-		//We found something to replace and this will be the first occurence of anything like that. Replace it!
-		if(firstFoundPos != std::string::npos)
-		{
-			foundPos = firstFoundPos;
-			const std::string & replacement = map.at(replaceThis);
-			text.replace(foundPos, replaceThis.length(), replacement);
-			foundPos += replacement.length(); //Let's make sure we start replacing from after where we just replaced
+				if(columnNamesFound)
+					*columnNamesFound = entry.columnNamesFound;
+
+				return entry.encoded;
+			}
 		}
-		else
-			foundPos = std::string::npos;
 	}
 
-	return text;
-}
-
-std::string ColumnEncoder::encodeRScript(std::string text, std::set<std::string> * columnNamesFound)
-{
-	return encodeRScript(text, encodingMap(), originalNames(), columnNamesFound);
-}
+	//The encoding itself is done without holding the lock, so other threads can use the cache in the meantime
+	EncodedRScript entry;
+	entry.hash			= hash;
+	entry.generation	= names->generation();
+	entry.script		= text;
+	entry.encoded		= names->rScriptEncoder().replace(text, &entry.columnNamesFound);
 
-std::string ColumnEncoder::encodeRScript(std::string text, const std::map<std::string, std::string> & map, const std::vector<std::string> & names, std::set<std::string> * columnNamesFound)
-{
 	if(columnNamesFound)
-		columnNamesFound->clear();
-
-	static std::regex nonNameChar("[^\\.A-Za-z0-9_]");
-
-	//for now we simply replace any found columnname by its encoded variant if found
-	for(const std::string & oldCol : names)
-	{
-		std::string	newCol	= map.at(oldCol);
+		*columnNamesFound = entry.columnNamesFound;
 
-		std::vector<size_t> foundColPositions = getPositionsColumnNameMatches(text, oldCol);
-		std::reverse(foundColPositions.begin(), foundColPositions.end());
+	std::string encoded = entry.encoded;
 
-		for (size_t foundPos : foundColPositions)
-		{
-			size_t foundPosEnd = foundPos + oldCol.length();
-
-			//First check if it is a "free columnname" aka is there some space or a kind in front of it. We would not want to replace a part of another term (Imagine what happens when you use a columname such as "E" and a filter that includes the term TRUE, it does not end well..)
-			bool startIsFree	= foundPos == 0					|| std::regex_match(text.substr(foundPos - 1, 1),	nonNameChar);
-			bool endIsFree		= foundPosEnd == text.length()	|| std::regex_match(text.substr(foundPosEnd, 1),	nonNameChar);
+	std::lock_guard<std::mutex> lock(_encodedRScriptsLock);
 
-			//Check for "(" as well because maybe someone has a columnname such as rep or if or something weird like that. This might however have some whitespace in between...
-			bool keepGoing = true;
+	_encodedRScripts.push_front(std::move(entry));
+	_encodedRScriptsIndex.insert(std::make_pair(hash, _encodedRScripts.begin()));
 
-			for(size_t bracePos = foundPosEnd; bracePos < text.size() && endIsFree && keepGoing; bracePos++)
-				if(text[bracePos] == '(')
-					endIsFree = false;
-				else if(text[bracePos] != '\t' && text[bracePos] != ' ')
-					keepGoing = false; //Aka something else than whitespace or a brace and that means that we can replace it!
+	if(_encodedRScripts.size() > _encodedRScriptsMax)
+	{
+		auto leastRecent	= std::prev(_encodedRScripts.end());
+		auto inIndex		= _encodedRScriptsIndex.equal_range(leastRecent->hash);
 
-			if(startIsFree && endIsFree)
+		for(auto hashEntry = inIndex.first; hashEntry != inIndex.second; hashEntry++)
+			if(hashEntry->second == leastRecent)
 			{
-				text.replace(foundPos, oldCol.length(), newCol);
-
-				if(columnNamesFound)
-					columnNamesFound->insert(oldCol);
+				_encodedRScriptsIndex.erase(hashEntry);
+				break;
 			}
-		}
+
+		_encodedRScripts.pop_back();
 	}
 
-	return text;
+	return encoded;
 }
 
-std::vector<size_t> ColumnEncoder::getPositionsColumnNameMatches(const std::string & text, const std::string & columnName)
+std::string ColumnEncoder::encodeRScript(const std::string & text, const std::map<std::string, std::string> & map, const std::vector<std::string> & names, std::set<std::string> * columnNamesFound)
 {
-	std::vector<size_t> positions;
-
-	bool inString	= false;
-	char delim		= '?';
-
-	for (std::string::size_type pos = 0; pos < text.length(); ++pos)
-		if (!inString && text.substr(pos, columnName.length()) == columnName)
-			positions.push_back(int(pos));
-		else if (text[pos] == '"' || text[pos] == '\'') //string starts or ends. This does not take into account escape characters though...
-		{
-			if (!inString)
-			{
-				delim		= text[pos];
-				inString	= true;
-			}
-			else if(text[pos] == delim)
-				inString = false;
-		}
-
-	return positions;
+	return RScriptNameReplacer(names, map).replace(text, columnNamesFound);
 }
 
-
 void ColumnEncoder::encodeJson(Json::Value & json, bool replaceNames, bool replaceStrict)
 {
 	//std::cout << "Json before encoding:\n" << json.toStyledString();
-	replaceAll(json, encodingMap(), originalNames(), replaceNames, replaceStrict);
+	encodeJson(*snapshot(), json, replaceNames, replaceStrict);
 	//std::cout << "Json after encoding:\n" << json.toStyledString() << std::endl;
 }
 
 void ColumnEncoder::decodeJson(Json::Value & json, bool replaceNames)
 {
 	//std::cout << "Json before encoding:\n" << json.toStyledString();
-	replaceAll(json, decodingMap(), encodedNames(), replaceNames, false);
+	decodeJson(*snapshot(), json, replaceNames);
 	//std::cout << "Json after encoding:\n" << json.toStyledString() << std::endl;
 }
 
+void ColumnEncoder::encodeJson(const ColumnEncoderSnapshot & names, Json::Value & json, bool replaceNames, bool replaceStrict)
+{
+	replaceAll(json, names, *names.encodingMatcher(), replaceNames, replaceStrict ? replaceMode::strict : replaceMode::all);
+}
+
+void ColumnEncoder::decodeJson(const ColumnEncoderSnapshot & names, Json::Value & json, bool replaceNames)
+{
+	replaceAll(json, names, *names.decodingMatcher(), replaceNames, replaceMode::all);
+}
+
 void ColumnEncoder::decodeJsonSafeHtml(Json::Value & json)
 {
-	replaceAll(json, decodingMapSafeHtml(), encodedNames(), true, false);
+	ColumnEncoderSnapshot::Ptr names = snapshot();
+	replaceAll(json, *names, *names->decodingMatcher(), true, replaceMode::safeHtml);
 }
 
 
-void ColumnEncoder::replaceAll(Json::Value & json, const std::map<std::string, std::string> & map, const std::vector<std::string> & names, bool replaceNames, bool replaceStrict)
+bool ColumnEncoder::replaceAll(std::string_view text, std::string & out, const ColumnEncoderSnapshot & snapshot, const ColumnNameMatcher & matcher, replaceMode mode)
+{
+	//Most strings in json contain no names at all, those we want to get rid of without copying anything
+	if(!matcher.mightMatch(text))
+		return false;
+
+	switch(mode)
+	{
+	case replaceMode::all:
+		return matcher.replaceAll(text, out);
+
+	case replaceMode::safeHtml: //Only the decoded names get escaped, straight into out
+		return matcher.replaceAll(text, out, [](std::string & out, const std::string & decoded) { stringUtils::appendEscapedHtml(out, decoded, true); }); // replace square brackets for https://github.com/jasp-stats/jasp-issues/issues/2625
+
+	case replaceMode::strict:
+		break;
+	}
+
+	std::string replacement;
+
+	if(!snapshot.encode(text, replacement) || replacement == text)
+		return false;
+
+	out = std::move(replacement);
+	return true;
+}
+
+void ColumnEncoder::replaceAll(Json::Value & json, const ColumnEncoderSnapshot & snapshot, const ColumnNameMatcher & matcher, bool replaceNames, replaceMode mode)
 {
 	switch(json.type())
 	{
 	case Json::arrayValue:
 		for(Json::Value & option : json)
-			replaceAll(option, map, names, replaceNames, replaceStrict);
+			replaceAll(option, snapshot, matcher, replaceNames, mode);
 		return;
 
 	case Json::objectValue:
 	{
 		std::map<std::string, std::string> changedMembers;
 
-		for(const std::string & optionName : json.getMemberNames())
+		for(Json::Value::iterator option = json.begin(); option != json.end(); option++)
 		{
-			replaceAll(json[optionName], map, names, replaceNames, replaceStrict);
+			replaceAll(*option, snapshot, matcher, replaceNames, mode);
 
-			if(replaceNames)
-			{
-				std::string replacedName = replaceStrict ? replaceAllStrict(optionName, map) : replaceAll(optionName, map, names);
+			const char	*	nameEnd,
+						*	nameBegin = option.memberName(&nameEnd);
+			std::string		replacedName;
 
-				if(replacedName != optionName)
-					changedMembers[optionName] = replacedName;
-			}
+			if(replaceNames && replaceAll(std::string_view(nameBegin, nameEnd - nameBegin), replacedName, snapshot, matcher, mode))
+				changedMembers[std::string(nameBegin, nameEnd)] = std::move(replacedName);
 		}
 
 		for(const auto & origNew : changedMembers) //map is empty if !replaceNames
 		{
-			json[origNew.second] = json[origNew.first];
-			json.removeMember(origNew.first);
+			Json::Value member;
+			json.removeMember(origNew.first, &member);
+			json[origNew.second] = std::move(member);
 		}
 
 		return;
 	}
 
 	case Json::stringValue:
-		json = replaceStrict ? replaceAllStrict(json.asString(), map) : replaceAll(json.asString(), map, names);
+	{
+		const char	*	begin,
+					*	end;
+		std::string		replaced;
+
+		json.getString(&begin, &end);
+
+		if(replaceAll(std::string_view(begin, end - begin), replaced, snapshot, matcher, mode))
+			json = std::move(replaced);
+
 		return;
+	}
 
 	default:
 		return;
@@ -545,66 +573,58 @@ void ColumnEncoder::collectExtraEncodingsFromMetaJson(const Json::Value & json,
 	}
 }
 
-std::string ColumnEncoder::removeColumnNamesFromRScript(const std::string & rCode, const std::vector<std::string> & colsToRemove)
+RScriptNameReplacer ColumnEncoder::removalPlan(const std::vector<std::string> & colsToRemove)
 {
 	std::map<std::string, std::string> replaceBy;
 
 	for(const std::string & col : colsToRemove)
 		replaceBy[col] = "stop('column " + col + " was removed from this RScript')";
 
-	return replaceColumnNamesInRScript(rCode, replaceBy);
+	return renamePlan(replaceBy);
 }
 
-std::string ColumnEncoder::replaceColumnNamesInRScript(const std::string & rCode, const std::map<std::string, std::string> & changedNames)
+RScriptNameReplacer ColumnEncoder::renamePlan(const std::map<std::string, std::string> & changedNames)
 {
-	//Ok the trick here is to reuse the encoding code, we will first encode the original names and then change the encodings to point back to the replaced names.
-	ColumnEncoder tempEncoder(changedNames);
+	//Also replace the names with a type added, these are replaced by just the new name. Just like setCurrentNames the typed ones win if they happen to clash with some other name.
+	colMap	replaceBy	= changedNames;
+	colVec	names;
 
-	return
-		tempEncoder.replaceAll(
-			tempEncoder.encodeRScript(
-				rCode,
-				tempEncoder._encodingMap,
-				tempEncoder._originalNames
-			),
-			tempEncoder._decodingMap,
-			tempEncoder._encodedNames
-		);
+	for(const auto & oriNew : changedNames)
+		for(columnType colType : { columnType::scale, columnType::ordinal, columnType::nominal })
+			replaceBy[oriNew.first + "." + columnTypeToString(colType)] = oriNew.second;
+
+	names.reserve(replaceBy.size());
+	for(const auto & oriNew : replaceBy)
+		names.push_back(oriNew.first);
+
+	return RScriptNameReplacer(names, replaceBy);
 }
 
 ColumnEncoder::colVec ColumnEncoder::columnNames()
 {
-	return _columnEncoder ? _columnEncoder->_originalNames : colVec();
+	return snapshot()->sortedColumnNames().bigToSmall(); //Holds on to the snapshot until the copy is made
 }
 
 ColumnEncoder::colVec ColumnEncoder::columnNamesEncoded()
 {
-	return _columnEncoder ? _columnEncoder->_encodedNames : colVec();
+	ColumnEncoderSnapshot::Ptr names = snapshot();
+
+	return names->global() ? names->global()->allEncodedNames() : colVec();
 }
 
 void ColumnEncoder::_convertPreloadingDataOption(Json::Value & options, const std::string& optionName, colsPlusTypes& colTypes)
 {
-	Json::Value		newOption	=	Json::arrayValue,
-					typeList	= options[optionName]["types"],
-					valueList	= options[optionName]["value"];
-	std::string		optionKey	= options[optionName].isMember("optionKey") ? options[optionName]["optionKey"].asString() : "";
-
-	bool useSingleVal = false;
+	//Everything is done in place or moved, the option is replaced by newOption at the end anyway. So even big variable lists with interactions are not copied around.
+	Json::Value		&	option		=	options[optionName],
+					&	typeList	=	option["types"],
+					&	valueList	=	option["value"],
+						newOption	=	Json::arrayValue;
+	std::string			optionKey	=	option.isMember("optionKey") ? option["optionKey"].asString() : "";
 
-	if(valueList.isString())
-	{
-		std::string val = valueList.asString();
-		valueList = Json::arrayValue;
-		valueList.append(val);
-
-		useSingleVal = true; //Otherwise we break things like "splitBy" it seems
-	}
-	if(typeList.isString())
-	{
-		std::string type = typeList.asString();
-		typeList = Json::arrayValue;
-		typeList.append(type);
-	}
+	const bool	useSingleVal	= valueList.isString(), //Otherwise we break things like "splitBy" it seems
+				singleType		= typeList.isString();
+	const int	values			= useSingleVal	? 1 : valueList.size(),
+				types			= singleType	? 1 : typeList.size();
 
 	// The valueList can be either;
 	// . a list of strings, if it is a list of variables without interaction
@@ -613,11 +633,11 @@ void ColumnEncoder::_convertPreloadingDataOption(Json::Value & options, const st
 	//   In this case, is has an optionKey that gives where the variable names are.
 	//	 Also here, there can be interaction, so the optionKey can give either a list of strings or a list of array of strings.
 
-	for(int i=0; i<valueList.size(); i++)
+	for(int i=0; i<values; i++)
 	{
-		Json::Value jsonType		= typeList.size() > i ? typeList[i] : Json::nullValue,
-					jsonValueOrg	= valueList[i],
-					jsonValue		= optionKey.empty() ? jsonValueOrg : jsonValueOrg[optionKey];
+		const Json::Value	&	jsonType		= types > i ? (singleType ? typeList : typeList[i]) : Json::Value::nullSingleton();
+		Json::Value			&	jsonValueOrg	= useSingleVal ? valueList : valueList[i],
+							&	jsonValue		= optionKey.empty() ? jsonValueOrg : jsonValueOrg[optionKey];
 
 		if (jsonValue.isString())
 		{
@@ -626,17 +646,17 @@ void ColumnEncoder::_convertPreloadingDataOption(Json::Value & options, const st
 			std::string columnName = jsonValue.asString();
 			std::string columnNameWithType = columnName.empty() ? "" : (columnName + (hasType ? "." + type : ""));
 
+			if (!columnNameWithType.empty() && hasType)
+				colTypes.insert(std::make_pair(columnNameWithType, columnTypeFromString(type)));
+
 			if (optionKey.empty())
-				newOption.append(columnNameWithType);
+				newOption.append(std::move(columnNameWithType));
 			else
 			{
 				// Reuse original jsonValue in order to get the other members of the object
-				jsonValueOrg[optionKey] = columnNameWithType;
-				newOption.append(jsonValueOrg);
+				jsonValue = std::move(columnNameWithType);
+				newOption.append(std::move(jsonValueOrg));
 			}
-
-			if (!columnNameWithType.empty() && hasType)
-				colTypes.insert(std::make_pair(columnNameWithType, columnTypeFromString(type)));
 		}
 		else if (jsonValue.isArray())
 		{
@@ -650,45 +670,86 @@ void ColumnEncoder::_convertPreloadingDataOption(Json::Value & options, const st
 				bool hasType = type != "unknown" && columnTypeValidName(type);
 				std::string columnName = jsonColumnName.asString();
 				std::string columnNameWithType = columnName.empty() ? "" : (columnName + (hasType ? "." + type : ""));
-				newColumnNames.append(columnNameWithType);
 
 				if (!columnNameWithType.empty() && hasType)
 					colTypes.insert(std::make_pair(columnNameWithType, columnTypeFromString(type)));
+
+				newColumnNames.append(std::move(columnNameWithType));
 			}
 			if (optionKey.empty())
-				newOption.append(newColumnNames);
+				newOption.append(std::move(newColumnNames));
 			else
 			{
-				jsonValueOrg[optionKey] = newColumnNames;
-				newOption.append(jsonValueOrg);
+				jsonValue = std::move(newColumnNames);
+				newOption.append(std::move(jsonValueOrg));
 			}
 		}
 		else
-			newOption.append(jsonValueOrg);
+			newOption.append(std::move(jsonValueOrg));
 	}
 
-	options[optionName + ".types"] = options[optionName]["types"];
-	options[optionName] = !useSingleVal ? newOption : newOption[0];
+	options[optionName + ".types"] = std::move(typeList); //Adding a member doesn't move option around, std::map
+
+	//Json::Value's move assignment is a swap, so whatever is moved into option must not live inside of it anymore
+	Json::Value converted = useSingleVal ? std::move(newOption[0]) : std::move(newOption);
+	option = std::move(converted);
+}
+
+void ColumnEncoder::_convertTypedOptions(Json::Value & options, bool preloadingData, colsPlusTypes & colTypes, std::vector<std::string> & converted)
+{
+	//The names are collected first because converting adds "optionname".types members, which should not be looked at as if they were there from the start
+	std::vector<std::string> typedOptions;
+
+	for(Json::Value::iterator option = options.begin(); option != options.end(); option++)
+		if (option->isObject() && option->isMember("value") && option->isMember("types"))
+			typedOptions.push_back(option.name());
+
+	for(const std::string & optionName : typedOptions)
+	{
+		Json::Value & option = options[optionName];
+
+		if (!option.isObject() || !option.isMember("value") || !option.isMember("types")) //Might be overwritten by an earlier conversion, as "optionname".types
+			continue;
+
+		converted.push_back(optionName);
+
+		if(!options.isMember(optionName + ".types"))
+			converted.push_back(optionName + ".types");
+
+		if(preloadingData) //make sure "optionname".types is available for analyses incapable of preloadingData, this should be considered deprecated
+			_convertPreloadingDataOption(options, optionName, colTypes);
+		else
+		{
+			Json::Value value = std::move(option["value"]); //Moved out first, as option is about to be replaced by it
+
+			options[optionName + ".types"] = std::move(option["types"]);
+			option = std::move(value);
+		}
+	}
+}
+
+bool ColumnEncoder::_wasConverted(std::string_view optionName, const std::vector<std::string> & converted)
+{
+	for(const std::string & convertedName : converted)
+		if(convertedName == optionName)
+			return true;
+
+	return false;
 }
 
 void ColumnEncoder::_addTypeToColumnNamesInOptionsRecursively(Json::Value & options, bool preloadingData, colsPlusTypes& colTypes)
 {
 	if (options.isObject())
 	{
-		for (const std::string& optionName : options.getMemberNames())
+		std::vector<std::string> converted;
+		_convertTypedOptions(options, preloadingData, colTypes, converted);
+
+		for(Json::Value::iterator option = options.begin(); option != options.end(); option++)
 		{
-			if (options[optionName].isObject() && options[optionName].isMember("value") && options[optionName].isMember("types"))
-			{
-				if(preloadingData) //make sure "optionname".types is available for analyses incapable of preloadingData, this should be considered deprecated
-					_convertPreloadingDataOption(options, optionName, colTypes);
-				else
-				{
-					options[optionName + ".types"] = options[optionName]["types"];
-					options[optionName] = options[optionName]["value"];
-				}
-			}
-			else
-				_addTypeToColumnNamesInOptionsRecursively(options[optionName], preloadingData, colTypes);
+			const char * nameEnd, * nameBegin = option.memberName(&nameEnd);
+
+			if(converted.empty() || !_wasConverted(std::string_view(nameBegin, nameEnd - nameBegin), converted))
+				_addTypeToColumnNamesInOptionsRecursively(*option, preloadingData, colTypes);
 		}
 	}
 	else if (options.isArray())
@@ -702,64 +763,183 @@ ColumnEncoder::colsPlusTypes ColumnEncoder::encodeColumnNamesinOptions(Json::Val
 {
 	colsPlusTypes getTheseCols;
 
-	_addTypeToColumnNamesInOptionsRecursively(options, preloadingData, getTheseCols);
+	//Typed options in the meta get converted just like the options themselves, and the plan has to be made from what they turn into.
+	//The meta itself is only converted when its turn comes, so that happens once. It is small, copying it doesn't matter.
+	Json::Value meta = options[".meta"];
+	_addTypeToColumnNamesInOptionsRecursively(meta, preloadingData, getTheseCols);
+
+	OptionsEncodingPlan::Ptr plan = OptionsEncodingPlan::forMeta(meta);
 
 	//LOGGER << "Options before encoding: " << options.toStyledString() << std::endl;
 
-	_encodeColumnNamesinOptions(options, options[".meta"]);
+	_addTypeAndEncodeColumnNamesInOptions(options, preloadingData, getTheseCols, *plan, plan->root());
 
 	//LOGGER << "Options after encoding: " << options.toStyledString() << std::endl;
 	return getTheseCols;
 }
 
-void ColumnEncoder::_encodeColumnNamesinOptions(Json::Value & options, Json::Value & meta)
+void ColumnEncoder::_addTypeAndEncodeColumnNamesInOptions(Json::Value & options, bool preloadingData, colsPlusTypes & colTypes, const OptionsEncodingPlan & plan, const OptionsEncodingPlan::Step & step)
 {
-	if(meta.isNull())
+	//Does the same as _addTypeToColumnNamesInOptionsRecursively followed by _encodeColumnNamesinOptions, but in one go.
+	//Wherever the types have to be added before something gets encoded wholesale, or there is nothing to encode, it leaves that part to _addTypeToColumnNamesInOptionsRecursively.
+	typedef OptionsEncodingPlan::metaType metaType;
+
+	if(step.meta == metaType::none)
+	{
+		_addTypeToColumnNamesInOptionsRecursively(options, preloadingData, colTypes);
 		return;
-	
-	bool	encodePlease	= meta.isObject() && meta.get("shouldEncode",	false).asBool(),
-			isRCode			= meta.isObject() && meta.get("rCode",			false).asBool();
+	}
 
 	switch(options.type())
 	{
 	case Json::arrayValue:
-		if(encodePlease)
+		if(step.encode)
+		{
+			_addTypeToColumnNamesInOptionsRecursively(options, preloadingData, colTypes);
+			columnEncoder()->encodeJson(options, false, true); //If we already think we have columnNames just change it all
+		}
+		else if(step.meta == metaType::array)
+			for(int i=0; i<options.size(); i++)
+				if(i < step.children)	_addTypeAndEncodeColumnNamesInOptions(options[i], preloadingData, colTypes, plan, plan.element(step, i));
+				else					_addTypeToColumnNamesInOptionsRecursively(options[i], preloadingData, colTypes);
+
+		else if(step.rCode)
+		{
+			for(int i=0; i<options.size(); i++)
+				if(options[i].isString())	options[i] = columnEncoder()->encodeRScript(options[i].asString());
+				else						_addTypeToColumnNamesInOptionsRecursively(options[i], preloadingData, colTypes);
+		}
+		else if(step.meta == metaType::object) // The option is an array, and the meta is an object: each option element in the array must be encoded with the same meta
+			for(int i=0; i<options.size(); i++)
+				_addTypeAndEncodeColumnNamesInOptions(options[i], preloadingData, colTypes, plan, step);
+
+		else
+			_addTypeToColumnNamesInOptionsRecursively(options, preloadingData, colTypes);
+
+		return;
+
+	case Json::objectValue:
+	{
+		if(step.encode) //Any member without a meta has the whole object encoded, so all of it needs its types first
+		{
+			_addTypeToColumnNamesInOptionsRecursively(options, preloadingData, colTypes);
+			_encodeColumnNamesinOptions(options, plan, step);
+			return;
+		}
+
+		std::vector<std::string> converted;
+		_convertTypedOptions(options, preloadingData, colTypes, converted);
+
+		for(Json::Value::iterator member = options.begin(); member != options.end(); member++)
+		{
+			const char				*	nameEnd,
+									*	nameBegin	= member.memberName(&nameEnd);
+			std::string_view			name		(nameBegin, nameEnd - nameBegin);
+			const bool					typesDone	= !converted.empty() && _wasConverted(name, converted); //Those only need encoding
+			const OptionsEncodingPlan::Step	*	memberStep	= nullptr;
+
+			if(name != ".meta")
+			{
+				if(step.meta != metaType::object)
+					throw std::runtime_error("Option '" + std::string(name) + "' is part of an object but its meta is not an object!");
+
+				memberStep = plan.member(step, name);
+			}
+
+			if(memberStep)
+			{
+				if(typesDone)	_encodeColumnNamesinOptions(*member, plan, *memberStep);
+				else			_addTypeAndEncodeColumnNamesInOptions(*member, preloadingData, colTypes, plan, *memberStep);
+				continue;
+			}
+
+			if(!typesDone)
+				_addTypeToColumnNamesInOptionsRecursively(*member, preloadingData, colTypes);
+
+			if(step.rCode && member->isString())
+				*member = columnEncoder()->encodeRScript(member->asString());
+		}
+		return;
+	}
+
+	case Json::stringValue:
+		_encodeColumnNamesinOptions(options, plan, step);
+		return;
+
+	default:
+		return;
+	}
+}
+
+void ColumnEncoder::_encodeColumnNamesinOptions(Json::Value & options, const OptionsEncodingPlan & plan, const OptionsEncodingPlan::Step & step)
+{
+	typedef OptionsEncodingPlan::metaType metaType;
+
+	if(step.meta == metaType::none)
+		return;
+
+	switch(options.type())
+	{
+	case Json::arrayValue:
+		if(step.encode)
 			columnEncoder()->encodeJson(options, false, true); //If we already think we have columnNames just change it all
 		
-		else if(meta.type() == Json::arrayValue)
-			for(int i=0; i<options.size() && i < meta.size(); i++)
-				_encodeColumnNamesinOptions(options[i], meta[i]);
+		else if(step.meta == metaType::array)
+			for(int i=0; i<options.size() && i < step.children; i++)
+				_encodeColumnNamesinOptions(options[i], plan, plan.element(step, i));
 
-		else if(isRCode)
+		else if(step.rCode)
 		{
 			for(int i=0; i<options.size(); i++)
 				if(options[i].isString())
 					options[i] = columnEncoder()->encodeRScript(options[i].asString());
 		}
-		else if(meta.type() == Json::objectValue) // The option is an array, and the meta is an object: each option element in the array must be encoded with the same meta
+		else if(step.meta == metaType::object) // The option is an array, and the meta is an object: each option element in the array must be encoded with the same meta
 			for(int i=0; i<options.size(); i++)
-				_encodeColumnNamesinOptions(options[i], meta);
+				_encodeColumnNamesinOptions(options[i], plan, step);
 
 
 		return;
 
 	case Json::objectValue:
-		for(const std::string & memberName : options.getMemberNames())
-			if(memberName != ".meta" && meta.isMember(memberName))
-				_encodeColumnNamesinOptions(options[memberName], meta[memberName]);
-		
-			else if(isRCode && options[memberName].isString())
-				options[memberName] = columnEncoder()->encodeRScript(options[memberName].asString());
+	{
+		bool encodedWhole = false;
+
+		for(Json::Value::iterator member = options.begin(); member != options.end(); member++)
+		{
+			const char				*	nameEnd,
+									*	nameBegin	= member.memberName(&nameEnd);
+			std::string_view			name		(nameBegin, nameEnd - nameBegin);
+			const OptionsEncodingPlan::Step	*	memberStep	= nullptr;
+
+			if(name != ".meta")
+			{
+				if(step.meta != metaType::object)
+					throw std::runtime_error("Option '" + std::string(name) + "' is part of an object but its meta is not an object!");
+
+				memberStep = plan.member(step, name);
+			}
+
+			if(memberStep)
+				_encodeColumnNamesinOptions(*member, plan, *memberStep);
 		
-			else if(encodePlease)
-				columnEncoder()->encodeJson(options, false, true); //If we already think we have columnNames just change it all I guess?
+			else if(step.rCode && member->isString())
+				*member = columnEncoder()->encodeRScript(member->asString());
 		
+			else if(step.encode && !encodedWhole)
+			{
+				//If we already think we have columnNames just change it all. Doing that again for the next member without a meta wouldn't change anything anymore, so once is enough.
+				columnEncoder()->encodeJson(options, false, true);
+				encodedWhole = true;
+			}
+		}
 		return;
+	}
 
 	case Json::stringValue:
 			
-			if(isRCode)				options = columnEncoder()->encodeRScript(options.asString());
-			else if(encodePlease)	options = columnEncoder()->encodeAll(options.asString());
+			if(step.rCode)			options = columnEncoder()->encodeRScript(options.asString());
+			else if(step.encode)	options = columnEncoder()->encodeAll(options.asString());
 			
 		return;
 
@@ -19,10 +19,22 @@
 #define COLUMNENCODER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <set>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
 #include "columntype.h"
+#include "columnnamematcher.h"
+#include "columnencoding.h"
+#include "columnencodersnapshot.h"
+#include "sortedcolumnnames.h"
+#include "rscriptnamereplacer.h"
+#include "sharedcolumnnames.h"
+#include "optionsencodingplan.h"
 #ifdef BUILDING_JASP
 #include <json/json.h>
 #else
@@ -33,6 +45,11 @@
 /// It can be used both directly, through columnEncoder()->, in that scenario it only en- and decodes actual columnNames from the dataset.
 /// If you want to en- or decode other names then you instantiate a separate copy and use it's functions.
 /// It will then also use the columnnames if they are set btw.
+///
+/// Changing the names is meant to happen from one thread, but all static en- and decoding functions can be used from as many threads as you like at the same time.
+/// They work on a ColumnEncoderSnapshot that is swapped in atomically whenever the names change, so a change never has to wait for them to finish and they never see half of one.
+/// That swap is not entirely lock-free though: std::atomic_load and std::atomic_store of a std::shared_ptr take a short internal lock in libstdc++ and MSVC, just for copying the pointer,
+/// and the first to use a new snapshot for something builds its matchers while others that want the same one wait for it (see ColumnEncoderSnapshot). The R-script cache has a lock of its own as well.
 class ColumnEncoder
 {
 public:
@@ -41,10 +58,14 @@ public:
 	typedef std::vector<std::string>							colVec;
 	typedef std::set<ColumnEncoder *>							ColumnEncoders;
 	typedef std::set<std::pair<std::string, columnType>>		colsPlusTypes;
+	typedef std::vector<std::string_view>						colViews;
 
-private:						ColumnEncoder() { invalidateAll(); }
+	///A shared encoder is one of the others that the static functions use, a scoped one is only used explicitly and never touches them nor makes them rebuild anything.
+	enum class encoderScope { shared, scoped };
+
+private:						ColumnEncoder();
 public:
-								ColumnEncoder(std::string prefix, std::string postfix = "_Encoded");
+								ColumnEncoder(std::string prefix, std::string postfix = "_Encoded", encoderScope scope = encoderScope::shared);
 								ColumnEncoder(const std::map<std::string, std::string> & decodeDifferently);
 								~ColumnEncoder();
 	static ColumnEncoder	*	columnEncoder();
@@ -52,33 +73,86 @@ public:
 	static	bool				isColumnName(const std::string & in)							{ return columnEncoder()->shouldEncode(in); }
 	static	bool				isEncodedColumnName(const std::string & in)						{ return columnEncoder()->shouldDecode(in); }
 	static	void				setCurrentColumnNames(const std::vector<std::string> & names)	{ columnEncoder()->setCurrentNames(names);	}
-
-	static	std::string			replaceColumnNamesInRScript(const std::string & rCode, const std::map<std::string, std::string> & changedNames);
-	static	std::string			removeColumnNamesFromRScript(const std::string & rCode, const std::vector<std::string> & colsToRemove);
+	static	void				addColumnNames(const std::vector<std::string> & names)			{ columnEncoder()->addColumns(names);		}
+	static	void				removeColumnNames(const std::vector<std::string> & names)		{ columnEncoder()->removeColumns(names);	}
+	static	void				renameColumnName(const std::string & oldName, const std::string & newName) { columnEncoder()->renameColumn(oldName, newName); }
+	static	std::string			serializedColumnNames()											{ return columnEncoder()->serializedNames();	}
+	static	void				setSerializedColumnNames(std::string_view data)					{ columnEncoder()->setSerializedNames(data);	}
+	static	SharedColumnNames::Ptr	publishSharedColumnNames(const std::string & segmentName)	{ return columnEncoder()->publishSharedNames(segmentName);	}
+	static	void				setSharedColumnNames(const SharedColumnNames::Ptr & shared)		{ columnEncoder()->setSharedNames(shared);	}
+
+	static	std::string			replaceColumnNamesInRScript(const std::string & rCode, const std::map<std::string, std::string> & changedNames)	{ return renamePlan(changedNames).replace(rCode);		}
+	static	std::string			removeColumnNamesFromRScript(const std::string & rCode, const std::vector<std::string> & colsToRemove)			{ return removalPlan(colsToRemove).replace(rCode);	}
+
+			///Builds what replaceColumnNamesInRScript and removeColumnNamesFromRScript do once, so it can be applied to all computed columns and filters (possibly in parallel) without redoing it for each.
+	static	RScriptNameReplacer	renamePlan(const std::map<std::string, std::string> & changedNames);
+	static	RScriptNameReplacer	removalPlan(const std::vector<std::string> & colsToRemove);
 	
-	static	colVec				columnNames();
+	static	colVec				columnNames(); ///< Big to small, with the typed names
+	static	SortedColumnNames::Ptr	sortedColumnNames(); ///< The same, but only sorted again after the columns change, it keeps the snapshot it is from alive so it stays valid after that.
 	static	colVec				columnNamesEncoded();
 
+			///The encodings as they are right now, hold on to it to do a whole bunch of work with the same names even when they change in the meantime.
+	static	ColumnEncoderSnapshot::Ptr	snapshot();
+
+			///The current snapshot with the names of this encoder added after all others, nothing global changes for it. Meant for scoped encoders, to en- or decode something for a single form or R call together with the columnNames.
+			///It is kept until either changes, so its matchers are only built once for all calls in between.
+			ColumnEncoderSnapshot::Ptr	withGlobal() const;
+
 			bool				shouldEncode(const std::string & in);
 			bool				shouldDecode(const std::string & in);
 			void				setCurrentNames(const std::vector<std::string> & names, bool generateTypesEncoding = true);
 			void				setCurrentNamesFromOptionsMeta(const Json::Value & json);
 
+			///Change some of the columns without renumbering anything else, so the encoded names of all other columns stay as they are.
+			///Added columns get counters after the highest one ever used, those of removed columns are never used again and renaming keeps them.
+			void				addColumns(const std::vector<std::string> & names);
+			void				removeColumns(const std::vector<std::string> & names);
+			void				renameColumn(const std::string & oldName, const std::string & newName);
+
+			///All names of this encoder as compact binary, another process (an engine for instance) can start from that with setSerializedNames instead of setCurrentNames.
+			///Reading it is little more than a memcpy per table, nothing is hashed or built again. Only meant for processes of the same build on the same machine.
+			std::string			serializedNames() const;
+			void				setSerializedNames(std::string_view data); ///< Throws if data is not something serializedNames made
+
+			///Puts serializedNames in a read-only shared memory segment, so that the engines can all use the same copy through setSharedNames. Its version is the generation of the current snapshot.
+			///The segment goes away when the returned pointer does, so keep it for as long as the engines should be able to attach to it. Throws if it cannot be made.
+			SharedColumnNames::Ptr	publishSharedNames(const std::string & segmentName) const;
+
+			///Use the names in a segment from SharedColumnNames::attach without copying its tables, they are only copied if the columns change afterwards. Throws if it doesn't contain names.
+			void				setSharedNames(const SharedColumnNames::Ptr & shared);
+
+			///These, and encodeRScript, use withGlobal() for a scoped encoder so it knows its own names as well.
 			std::string			encode(const std::string &in);
 			std::string			decode(const std::string &in);
 
+			///En- or decode a whole vector of names in one go, names that cannot be en- or decoded end up unchanged in out and get false in found. Nothing is thrown.
+			void				encode(const colVec		& in, colVec & out, std::vector<bool> * found = nullptr);
+			void				encode(const colViews	& in, colVec & out, std::vector<bool> * found = nullptr);
+			void				decode(const colVec		& in, colVec & out, std::vector<bool> * found = nullptr);
+			void				decode(const colViews	& in, colVec & out, std::vector<bool> * found = nullptr);
+
 			columnType			columnTypeFromEncoded(const std::string & in);
 
 
 			///Replace all occurences of columnNames in a string by their encoded versions, taking into account the presence of word boundaries and parentheses.
-			std::string			encodeRScript(std::string text, std::set<std::string> * columnNamesFound = nullptr);
-			std::string			encodeRScript(std::string text, const std::map<std::string, std::string> & map, const std::vector<std::string> & names, std::set<std::string> * columnNamesFound = nullptr);
+			///The last couple of scripts encoded with the current columnNames are remembered, so re-running the same filter or computed column costs nothing.
+			std::string			encodeRScript(const std::string & text, std::set<std::string> * columnNamesFound = nullptr);
+			std::string			encodeRScript(const std::string & text, const std::map<std::string, std::string> & map, const std::vector<std::string> & names, std::set<std::string> * columnNamesFound = nullptr);
 
 			///Replace all occurences of columnNames in a string by their encoded versions, regardless of word boundaries or parentheses.
-	static	std::string			encodeAll(const std::string & text) { return replaceAll(text, encodingMap(), originalNames()); }
+	static	std::string			encodeAll(const std::string & text) { return snapshot()->encodingMatcher()->replaceAll(text); }
 
 			///Replace all occurences of encoded columnNames in a string by their decoded versions, regardless of word boundaries or parentheses.
-	static	std::string			decodeAll(const std::string & text) { return replaceAll(text, decodingMap(), encodedNames());  }
+			///As long as all encoders share prefix and postfix this only looks for the prefix and reads the counter behind it, which is a lot faster than a generic search.
+	static	std::string			decodeAll(const std::string & text) { return snapshot()->decodingMatcher()->replaceAll(text); }
+
+			///Same as encodeAll and decodeAll but spread over a number of threads (0 means as many as WorkerPool::pool() has), the result is identical. Only worth it for texts of many megabytes.
+	static	std::string			encodeAll(const std::string & text, size_t threads) { return snapshot()->encodingMatcher()->replaceAllParallel(text, threads); }
+	static	std::string			decodeAll(const std::string & text, size_t threads) { return snapshot()->decodingMatcher()->replaceAllParallel(text, threads); }
+
+			///Same as decodeAll but for text that comes in chunk by chunk, uses the encodings as they are when this is called.
+	static	ColumnNameStreamReplacer	decodeStream() { return ColumnNameStreamReplacer(snapshot()->decodingMatcher()); }
 
 			///Replace all occurences of columnNames in a string by their encoded versions in all json-names and string-values, regardless of word boundaries or parentheses.
 	static	void				encodeJson(Json::Value & json, bool replaceNames = false, bool replaceStrict = false);
@@ -87,47 +161,63 @@ public:
 	static	void				decodeJson(Json::Value & json, bool replaceNames = true);
 	static	void				decodeJsonSafeHtml(Json::Value & json);
 
+			///The same as the above but with some specific snapshot, for instance from withGlobal().
+	static	std::string			encodeAll(const ColumnEncoderSnapshot & names, const std::string & text) { return names.encodingMatcher()->replaceAll(text); }
+	static	std::string			decodeAll(const ColumnEncoderSnapshot & names, const std::string & text) { return names.decodingMatcher()->replaceAll(text); }
+	static	void				encodeJson(const ColumnEncoderSnapshot & names, Json::Value & json, bool replaceNames = false, bool replaceStrict = false);
+	static	void				decodeJson(const ColumnEncoderSnapshot & names, Json::Value & json, bool replaceNames = true);
+
 	static	colsPlusTypes		encodeColumnNamesinOptions(Json::Value & options, bool preloadingData);
 
 private:
 	static	void				_convertPreloadingDataOption(Json::Value & option, const std::string& optionName, colsPlusTypes& colTypes);
+	static	void				_convertTypedOptions(Json::Value & options, bool preloadingData, colsPlusTypes & colTypes, std::vector<std::string> & converted); ///< Of an object, converted gets their names and the names of the ".types" members that got added
+	static	bool				_wasConverted(std::string_view optionName, const std::vector<std::string> & converted);
 	static	void				_addTypeToColumnNamesInOptionsRecursively(Json::Value & options, bool preloadingData, colsPlusTypes& colTypes);
-	static	void				_encodeColumnNamesinOptions(Json::Value & options, Json::Value & meta);
+	static	void				_addTypeAndEncodeColumnNamesInOptions(Json::Value & options, bool preloadingData, colsPlusTypes & colTypes, const OptionsEncodingPlan & plan, const OptionsEncodingPlan::Step & step);
+	static	void				_encodeColumnNamesinOptions(Json::Value & options, const OptionsEncodingPlan & plan, const OptionsEncodingPlan::Step & step);
 
 private:
-	static	std::string			replaceAll(std::string text, const std::map<std::string, std::string> & map, const std::vector<std::string> & names);
-	static  std::string			replaceAllStrict(const std::string & text, const std::map<std::string, std::string> & map);
+	enum class replaceMode { all, strict, safeHtml }; ///< strict only works for encoding, safeHtml escapes the replacements for html
 
-	static	void				replaceAll(Json::Value & json, const std::map<std::string, std::string> & map, const std::vector<std::string> & names, bool replaceNames, bool replaceStrict);
-	static	std::vector<size_t>	getPositionsColumnNameMatches(const std::string & text, const std::string & columnName);
+	static	void				replaceAll(Json::Value & json, const ColumnEncoderSnapshot & snapshot, const ColumnNameMatcher & matcher, bool replaceNames, replaceMode mode);
+	static	bool				replaceAll(std::string_view text, std::string & out, const ColumnEncoderSnapshot & snapshot, const ColumnNameMatcher & matcher, replaceMode mode);
 			void				collectExtraEncodingsFromMetaJson(const Json::Value & in, std::vector<std::string> & namesCollected) const;
-	static	void				sortVectorBigToSmall(std::vector<std::string> & vec);
-	static	const colMap	&	encodingMap();
-	static	const colMap	&	decodingMap();
-	static	const colTypeMap&	decodingTypes();
-	static	const colMap	&	decodingMapSafeHtml();
-	static	const colVec	&	originalNames();
-	static	const colVec	&	encodedNames();
-	static	void				invalidateAll();
-
-	static	bool				_encodingMapInvalidated,
-								_decodingMapInvalidated,
-								_decodingTypeInvalidated,
-								_decoSafeMapInvalidated,
-								_originalNamesInvalidated,
-								_encodedNamesInvalidated;
+
+			template<typename Names>
+	static	void				lookupAll(const ColumnEncoderSnapshot & names, const Names & in, colVec & out, std::vector<bool> * found, bool encoding);
+			ColumnEncoderSnapshot::Ptr	lookupSnapshot() const { return _scope == encoderScope::scoped ? withGlobal() : snapshot(); }
+			std::shared_ptr<ColumnEncoding>	copyOfEncoding() const;
+			void				setEncoding(ColumnEncoding::Ptr encoding, const ColumnEncoderSnapshot::Changes * changes = nullptr); ///< And let everyone know, changes is what the new snapshot needs to build on the previous one
+	static	void				invalidateAll(const ColumnEncoderSnapshot::Changes * changes = nullptr);
+
+	struct EncodedRScript
+	{
+		size_t					hash,
+								generation;
+		std::string				script,
+								encoded;
+		std::set<std::string>	columnNamesFound;
+	};
+
+	typedef std::list<EncodedRScript>											EncodedRScripts;
+	typedef std::unordered_multimap<size_t, EncodedRScripts::iterator>			EncodedRScriptsIndex;
+
+	static	EncodedRScripts			_encodedRScripts;		///< Most recently used first
+	static	EncodedRScriptsIndex	_encodedRScriptsIndex;	///< By hash of the script
+	static	const size_t			_encodedRScriptsMax;
+	static	std::mutex				_encodedRScriptsLock;
+	static	size_t					_generation;			///< Goes up whenever the encodings change
+
+	static	ColumnEncoderSnapshot::Ptr	_snapshot;			///< Only ever touched through std::atomic_load and std::atomic_store
 
 	static ColumnEncoder	*	_columnEncoder;
 	static ColumnEncoders	*	_otherEncoders;
 
-	colMap						_encodingMap,
-								_decodingMap;
-	colVec						_originalNames,
-								_encodedNames;
-	colTypeMap					_decodingTypes;
+	ColumnEncoding::Ptr			_encoding;		///< Never changed, only replaced. Through std::atomic_load and std::atomic_store as well.
+	encoderScope				_scope = encoderScope::shared;
 
-	std::string					_encodePrefix  = "JaspColumn_",
-								_encodePostfix = "_Encoded";
+	mutable ColumnEncoderSnapshot::Ptr	_withGlobal;	///< What withGlobal() made last, also through std::atomic_load and std::atomic_store
 };
 
 #endif // COLUMNENCODER_H
@@ -0,0 +1,212 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "columnencodersnapshot.h"
+
+static std::vector<ColumnEncoding::Ptr> globalFirst(ColumnEncoding::Ptr global, std::vector<ColumnEncoding::Ptr> others)
+{
+	if(global)
+		others.insert(others.begin(), global);
+
+	return others;
+}
+
+ColumnEncoderSnapshot::ColumnEncoderSnapshot(ColumnEncoding::Ptr global, std::vector<ColumnEncoding::Ptr> others, size_t generation)
+	: _global(global), _encodings(globalFirst(global, std::move(others))), _generation(generation)
+{}
+
+static std::vector<ColumnEncoding::Ptr> extraLast(std::vector<ColumnEncoding::Ptr> encodings, ColumnEncoding::Ptr extra)
+{
+	encodings.push_back(extra);
+
+	return encodings;
+}
+
+ColumnEncoderSnapshot::ColumnEncoderSnapshot(const ColumnEncoderSnapshot & base, ColumnEncoding::Ptr extra)
+	: _global(base._global), _extra(extra), _encodings(extraLast(base._encodings, extra)), _generation(base._generation)
+{}
+
+ColumnEncoderSnapshot::ColumnEncoderSnapshot(const ColumnEncoderSnapshot & previous, const Changes & changes, ColumnEncoding::Ptr global, std::vector<ColumnEncoding::Ptr> others, size_t generation)
+	: _global(global), _encodings(globalFirst(global, std::move(others))), _generation(generation)
+{
+	colVec	encodingKeys = sortedUnique(changes.encodingKeys),
+			decodingKeys = sortedUnique(changes.decodingKeys);
+
+	_encodingMatcher.inherit(previous._encodingMatcher, encodingKeys);
+	_decodingMatcher.inherit(previous._decodingMatcher, decodingKeys);
+	_rScriptEncoder	.inherit(previous._rScriptEncoder,	encodingKeys);
+}
+
+ColumnEncoderSnapshot::colVec ColumnEncoderSnapshot::sortedUnique(colVec keys)
+{
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+	return keys;
+}
+
+bool ColumnEncoderSnapshot::encode(std::string_view name, std::string & encoded) const
+{
+	for(const ColumnEncoding::Ptr & encoding : _encodings)
+		if(encoding->findEncoded(name, encoded))
+			return true;
+
+	return false;
+}
+
+bool ColumnEncoderSnapshot::decode(std::string_view name, std::string_view & decoded, columnType * type) const
+{
+	for(const ColumnEncoding::Ptr & encoding : _encodings)
+		if(encoding->findDecoded(name, decoded, type))
+			return true;
+
+	return false;
+}
+
+const SortedColumnNames & ColumnEncoderSnapshot::sortedColumnNames() const
+{
+	std::call_once(_sortedNamesBuilt, [&]()
+	{
+		_sortedNames.set(_global ? _global->allOriginalNames() : colVec());
+	});
+
+	return _sortedNames;
+}
+
+const ColumnEncoding::NameList & ColumnEncoderSnapshot::encodings() const
+{
+	std::call_once(_encodingsBuilt, [&]()
+	{
+		//The global encoder goes first, the matchers keep the first of any name that occurs more than once so it wins from the others
+		for(const ColumnEncoding::Ptr & encoding : _encodings)
+			encoding->collectEncodings(_encodingList);
+	});
+
+	return _encodingList;
+}
+
+const ColumnEncoding::NameList & ColumnEncoderSnapshot::decodings() const
+{
+	std::call_once(_decodingsBuilt, [&]()
+	{
+		for(const ColumnEncoding::Ptr & encoding : _encodings)
+			encoding->collectDecodings(_decodingList);
+	});
+
+	return _decodingList;
+}
+
+ColumnEncoderSnapshot::colViews ColumnEncoderSnapshot::viewsOf(const colVec & names)
+{
+	return colViews(names.begin(), names.end());
+}
+
+void ColumnEncoderSnapshot::encodeAll(const colVec & keys, colVec & names, colVec & replacements) const
+{
+	std::string encoded;
+
+	//A key that doesn't encode anymore is simply left out, it is hidden in the base all the same
+	for(const std::string & key : keys)
+		if(encode(key, encoded))
+		{
+			names			.push_back(key);
+			replacements	.push_back(encoded);
+		}
+}
+
+void ColumnEncoderSnapshot::decodeAll(const colVec & keys, colVec & names, colVec & replacements) const
+{
+	std::string_view decoded;
+
+	for(const std::string & key : keys)
+		if(decode(key, decoded))
+		{
+			names			.push_back(key);
+			replacements	.push_back(std::string(decoded));
+		}
+}
+
+const ColumnNameMatcher::Ptr & ColumnEncoderSnapshot::encodingMatcher() const
+{
+	return _encodingMatcher.get(
+		[&]()
+		{
+			return std::make_shared<const ColumnNameMatcher>(viewsOf(encodings().names), viewsOf(encodings().replacements));
+		},
+		[&](const ColumnNameMatcher::Ptr & base, const colVec & changed)
+		{
+			colVec names, replacements;
+			encodeAll(changed, names, replacements);
+
+			return std::make_shared<const ColumnNameMatcher>(base, viewsOf(changed), viewsOf(names), viewsOf(replacements));
+		});
+}
+
+const RScriptNameReplacer & ColumnEncoderSnapshot::rScriptEncoder() const
+{
+	return *_rScriptEncoder.get(
+		[&]()
+		{
+			return std::make_shared<const RScriptNameReplacer>(viewsOf(encodings().names), viewsOf(encodings().replacements));
+		},
+		[&](const RScriptNameReplacer::Ptr & base, const colVec & changed)
+		{
+			colVec names, replacements;
+			encodeAll(changed, names, replacements);
+
+			return std::make_shared<const RScriptNameReplacer>(base, viewsOf(changed), viewsOf(names), viewsOf(replacements));
+		});
+}
+
+bool ColumnEncoderSnapshot::sharedEncodingFormat(std::string & prefix, std::string & postfix) const
+{
+	if(_encodings.empty())
+		return false;
+
+	prefix	= _encodings[0]->prefix();
+	postfix	= _encodings[0]->postfix();
+
+	for(size_t i = 1; i < _encodings.size(); i++)
+		if(!_encodings[i]->empty() && (_encodings[i]->prefix() != prefix || _encodings[i]->postfix() != postfix))
+			return false;
+
+	return true;
+}
+
+const ColumnNameMatcher::Ptr & ColumnEncoderSnapshot::decodingMatcher() const
+{
+	//If all encoded names look like prefix + counter + postfix the matcher can simply look for the prefix, otherwise it falls back to the generic search.
+	std::string prefix, postfix;
+
+	if(!sharedEncodingFormat(prefix, postfix))
+		prefix = postfix = "";
+
+	return _decodingMatcher.get(
+		[&]()
+		{
+			const ColumnEncoding::NameList & list = decodings();
+
+			return std::make_shared<const ColumnNameMatcher>(viewsOf(list.names), viewsOf(list.replacements), prefix, postfix);
+		},
+		[&](const ColumnNameMatcher::Ptr & base, const colVec & changed)
+		{
+			colVec names, replacements;
+			decodeAll(changed, names, replacements);
+
+			return std::make_shared<const ColumnNameMatcher>(base, viewsOf(changed), viewsOf(names), viewsOf(replacements), prefix, postfix);
+		});
+}
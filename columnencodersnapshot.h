@@ -0,0 +1,143 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef COLUMNENCODERSNAPSHOT_H
+#define COLUMNENCODERSNAPSHOT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <iterator>
+#include "columnencoding.h"
+#include "columnnamematcher.h"
+#include "sortedcolumnnames.h"
+#include "rscriptnamereplacer.h"
+
+/// The encodings of all ColumnEncoders together as they were at one moment, this is what the static en- and decoding functions of ColumnEncoder work with.
+/// It never changes after construction so any number of threads can use one at the same time, except for the lazily built parts below nothing is locked.
+/// When the columns change ColumnEncoder makes a new one and swaps it in atomically, whoever still holds on to the old one can just keep using it.
+/// The matchers and such are only built when first asked for, std::call_once makes sure that happens once even if several threads ask at the same time.
+/// If only a couple of columns were added, removed or renamed since the previous snapshot they are built on top of what that one built,
+/// so only the names that changed need to go in a new matcher instead of all of them.
+class ColumnEncoderSnapshot
+{
+public:
+	typedef std::shared_ptr<const ColumnEncoderSnapshot>	Ptr;
+	typedef ColumnEncoding::colVec							colVec;
+	typedef std::vector<std::string_view>					colViews;
+
+	///The names that might en- or decode differently than in the snapshot before, see ColumnEncoding::collectAffected.
+	struct Changes
+	{
+		colVec	encodingKeys,
+				decodingKeys;
+	};
+
+								ColumnEncoderSnapshot(ColumnEncoding::Ptr global, std::vector<ColumnEncoding::Ptr> others, size_t generation);
+								ColumnEncoderSnapshot(const ColumnEncoderSnapshot & previous, const Changes & changes, ColumnEncoding::Ptr global, std::vector<ColumnEncoding::Ptr> others, size_t generation); ///< Builds on top of what previous built, as long as not too much changed
+								ColumnEncoderSnapshot(const ColumnEncoderSnapshot & base, ColumnEncoding::Ptr extra); ///< The encodings of base and then extra, nothing of base that was already built is reused
+
+			///The global encoder first and then the others, just like the matchers do it.
+			bool				encode(std::string_view name, std::string		& encoded)								const;
+			bool				decode(std::string_view name, std::string_view	& decoded, columnType * type = nullptr)	const;
+
+			size_t				generation()	const { return _generation;	}
+	const	ColumnEncoding::Ptr	&	global()	const { return _global;		} ///< Might be null
+	const	ColumnEncoding::Ptr	&	extra()		const { return _extra;		} ///< Null unless made with the constructor that takes one
+
+	const	SortedColumnNames				&	sortedColumnNames()			const; ///< Of the global encoder
+	const	ColumnNameMatcher::Ptr			&	encodingMatcher()			const;
+	const	ColumnNameMatcher::Ptr			&	decodingMatcher()			const;
+	const	RScriptNameReplacer				&	rScriptEncoder()			const;
+
+private:
+	/// Something that is built when first asked for, either from scratch or on top of what an earlier snapshot built from scratch.
+	/// The latter only ever goes one deep: the snapshot after this one builds on top of the same base, with the keys of both.
+	template<typename Built>
+	struct Layer
+	{
+		typedef std::shared_ptr<const Built> Ptr;
+
+		///Takes over the base of previous, or what previous built if that was from scratch, unless that would leave too much to hide.
+		void inherit(const Layer & previous, const colVec & keys)
+		{
+			if(previous.ready.load(std::memory_order_acquire) && !previous.base)	base = previous.built;
+			else if(previous.base)												base = previous.base;
+			else																return;
+
+			if(base == previous.base)
+				std::set_union(previous.changed.begin(), previous.changed.end(), keys.begin(), keys.end(), std::back_inserter(changed));
+			else
+				changed = keys;
+
+			if(changed.size() > std::max(size_t(256), base->size() / 8))
+			{
+				base = nullptr;
+				changed.clear();
+			}
+		}
+
+		template<typename FromScratch, typename OnBase>
+		const Ptr & get(FromScratch fromScratch, OnBase onBase) const
+		{
+			std::call_once(once, [&]()
+			{
+				built = base ? onBase(base, changed) : fromScratch();
+				ready.store(true, std::memory_order_release);
+			});
+
+			return built;
+		}
+
+		Ptr							base;			///< Never changes after the snapshot is made
+		colVec						changed;		///< Sorted, the keys that might not be what base makes of them
+		mutable std::once_flag		once;
+		mutable std::atomic<bool>	ready	= false;	///< So the next snapshot can tell whether built is there without waiting for it
+		mutable Ptr					built;
+	};
+
+	const	ColumnEncoding::NameList		&	encodings()					const; ///< Only needed to build the matchers from scratch
+	const	ColumnEncoding::NameList		&	decodings()					const;
+			bool				sharedEncodingFormat(std::string & prefix, std::string & postfix) const;
+			void				encodeAll(const colVec & keys, colVec & names, colVec & replacements) const; ///< The keys that encode, and what to
+			void				decodeAll(const colVec & keys, colVec & names, colVec & replacements) const;
+	static	colViews			viewsOf(const colVec & names);
+	static	colVec				sortedUnique(colVec keys);
+
+	const ColumnEncoding::Ptr					_global,
+												_extra;
+	const std::vector<ColumnEncoding::Ptr>		_encodings;		///< Global first, if there is one
+	const size_t								_generation;
+
+	mutable std::once_flag						_encodingsBuilt,
+												_decodingsBuilt,
+												_sortedNamesBuilt;
+
+	mutable ColumnEncoding::NameList			_encodingList,
+												_decodingList;
+	mutable SortedColumnNames					_sortedNames;
+
+	Layer<ColumnNameMatcher>					_encodingMatcher,
+												_decodingMatcher;
+	Layer<RScriptNameReplacer>					_rScriptEncoder;
+};
+
+#endif // COLUMNENCODERSNAPSHOT_H
@@ -0,0 +1,501 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "columnencoding.h"
+#include <stdexcept>
+
+void ColumnEncoding::setNames(const colVec & names, bool generateTypesEncoding)
+{
+	_names.clear();
+	_names.reserve(names.size() * 2);
+
+	_originalIds.clear();
+	_encodedIds	.clear();
+	_originalIds.reserve(names.size());
+	_encodedIds	.reserve(names.size());
+
+	//The names with a type added get counters after the plain ones: names.size() + 3 * col + type, those are worked out when asked for instead of stored.
+	//Most analyses only use a few of them and this way the counters are still always the same.
+	_typesEncoded	= generateTypesEncoding;
+	_firstColumns	= names.size();
+	_duplicates		= false;
+
+	//First normal encoding decoding: (Although im not sure we would ever need those again?)
+	for(size_t col = 0; col < names.size(); col++)
+		addColumn(names[col]);
+}
+
+void ColumnEncoding::addColumn(const std::string & name)
+{
+	size_t		col			= _originalIds.size();
+	uint32_t	original	= _names.intern(name),
+				newName		= _names.intern(encodedName(encodedCounter(col))), //Slightly weird (but R-syntactically valid) name to avoid collisions with user stuff.
+				encoded		= _names.encodedId(original);
+
+	if(encoded == ColumnNameIndex::noId || _names.type(encoded) == columnType::unknown) //If it is also a typed name that one stays
+		_names.setEncoded(original, newName);
+
+	if(_names.column(original) != ColumnNameIndex::noId) //setCurrentNamesFromOptionsMeta for instance doesn't make sure they are unique, the last one is the column
+		_duplicates = true;
+
+	_names.setDecoded(newName, original);
+	_names.setColumn(original, col);
+
+	_originalIds.push_back(original);
+	_encodedIds	.push_back(newName);
+}
+
+void ColumnEncoding::addColumns(const colVec & names)
+{
+	for(const std::string & name : names)
+		if(!columnExists(name))
+			addColumn(name);
+}
+
+void ColumnEncoding::removeColumns(const colVec & names)
+{
+	for(const std::string & name : names)
+		if(columnExists(name))
+		{
+			uint32_t	original	= _names.find(name);
+			size_t		col			= _names.column(original);
+
+			forgetTypedNames(original);
+
+			if(_names.encodedId(original) == _encodedIds[col])
+				_names.setEncoded(original, ColumnNameIndex::noId);
+
+			_names.setColumn(original, ColumnNameIndex::noId);
+
+			//The slots stay, empty, so that no other column ever gets these counters. If the name occurs more than once it is gone from all of them.
+			for(size_t slot : slotsOf(original, col))
+			{
+				_names.setDecoded(_encodedIds[slot], ColumnNameIndex::noId);
+
+				_originalIds.edit(slot)	= ColumnNameIndex::noId;
+				_encodedIds	.edit(slot)	= ColumnNameIndex::noId;
+			}
+		}
+}
+
+void ColumnEncoding::renameColumn(const std::string & oldName, const std::string & newName)
+{
+	if(!columnExists(oldName))
+		throw std::runtime_error("Trying to rename column '" + oldName + "' but it is not a columnName!");
+
+	if(oldName == newName)
+		return;
+
+	if(columnExists(newName))
+		throw std::runtime_error("Trying to rename column '" + oldName + "' to '" + newName + "' but that is already a columnName!");
+
+	uint32_t	oldId	= _names.find(oldName);
+	size_t		col		= _names.column(oldId);
+
+	forgetTypedNames(oldId);
+
+	if(_names.encodedId(oldId) == _encodedIds[col])
+		_names.setEncoded(oldId, ColumnNameIndex::noId);
+
+	_names.setColumn(oldId, ColumnNameIndex::noId);
+
+	//Same slot, so the encoded names stay the same and now decode to the new name
+	uint32_t	newId	= _names.intern(newName),
+				encoded	= _names.encodedId(newId);
+
+	if(encoded == ColumnNameIndex::noId || _names.type(encoded) == columnType::unknown)
+		_names.setEncoded(newId, _encodedIds[col]);
+
+	_names.setColumn(newId, col);
+
+	//If the old name occurs more than once all of them are renamed, otherwise the others would keep a name that isn't a column anymore
+	for(size_t slot : slotsOf(oldId, col))
+	{
+		_names.setDecoded(_encodedIds[slot], newId);
+		_originalIds.edit(slot) = newId;
+	}
+}
+
+std::vector<size_t> ColumnEncoding::slotsOf(uint32_t original, size_t col) const
+{
+	if(!_duplicates)
+		return { col };
+
+	std::vector<size_t> slots;
+
+	for(size_t slot = 0; slot < _originalIds.size(); slot++)
+		if(_originalIds[slot] == original)
+			slots.push_back(slot);
+
+	return slots;
+}
+
+bool ColumnEncoding::columnExists(const std::string & name) const
+{
+	uint32_t id = _names.find(name);
+
+	return id != ColumnNameIndex::noId && _names.column(id) != ColumnNameIndex::noId;
+}
+
+void ColumnEncoding::forgetTypedNames(uint32_t original)
+{
+	for(size_t typeIndex = 0; typeIndex < 3; typeIndex++)
+	{
+		uint32_t	typed	= _names.find(std::string(_names.name(original)) + typeSuffix(typeIndex)),
+					encoded	= typed == ColumnNameIndex::noId ? ColumnNameIndex::noId : _names.encodedId(typed);
+
+		if(encoded == ColumnNameIndex::noId || _names.decodedId(encoded) != original || _names.type(encoded) == columnType::unknown)
+			continue;
+
+		_names.setDecoded(encoded, ColumnNameIndex::noId);
+
+		//Maybe there is a column that is actually called like this, then that gets its own encoding back
+		_names.setEncoded(typed, _names.column(typed) == ColumnNameIndex::noId ? ColumnNameIndex::noId : _encodedIds[_names.column(typed)]);
+	}
+}
+
+size_t ColumnEncoding::encodedCounter(size_t col, int typeIndex) const
+{
+	//Columns set through setCurrentNames get counters 0 to n for their plain names, followed by 3 per column for the typed ones.
+	//Columns added later get a block of 1 or 4 counters after that, so nothing ever needs to be renumbered.
+	const size_t stride = _typesEncoded ? 4 : 1;
+
+	if(col < _firstColumns)
+		return typeIndex < 0 ? col : _firstColumns + 3 * col + typeIndex;
+
+	return stride * _firstColumns + stride * (col - _firstColumns) + (typeIndex + 1);
+}
+
+bool ColumnEncoding::columnFromCounter(size_t counter, size_t & col, int & typeIndex) const
+{
+	const size_t stride = _typesEncoded ? 4 : 1;
+
+	if(counter < _firstColumns)
+	{
+		col			= counter;
+		typeIndex	= -1;
+	}
+	else if(counter < stride * _firstColumns)
+	{
+		col			= (counter - _firstColumns) / 3;
+		typeIndex	= (counter - _firstColumns) % 3;
+	}
+	else
+	{
+		col			= _firstColumns + (counter - stride * _firstColumns) / stride;
+		typeIndex	= int((counter - stride * _firstColumns) % stride) - 1;
+	}
+
+	return col < _originalIds.size() && _originalIds[col] != ColumnNameIndex::noId;
+}
+
+std::string ColumnEncoding::encodedName(size_t counter) const
+{
+	return _encodePrefix + std::to_string(counter) + _encodePostfix;
+}
+
+bool ColumnEncoding::counterOf(std::string_view name, size_t & counter) const
+{
+	if(name.size() <= _encodePrefix.size() + _encodePostfix.size() || name.compare(0, _encodePrefix.size(), _encodePrefix) != 0 || name.compare(name.size() - _encodePostfix.size(), _encodePostfix.size(), _encodePostfix) != 0)
+		return false;
+
+	std::string_view digits = name.substr(_encodePrefix.size(), name.size() - _encodePrefix.size() - _encodePostfix.size());
+
+	if(digits.size() > 9 || (digits[0] == '0' && digits.size() > 1))
+		return false;
+
+	counter = 0;
+	for(char digit : digits)
+		if(digit < '0' || digit > '9')	return false;
+		else							counter = counter * 10 + (digit - '0');
+
+	return true;
+}
+
+const std::string & ColumnEncoding::typeSuffix(size_t typeIndex)
+{
+	static const std::string suffixes[] = { "." + columnTypeToString(columnType::scale), "." + columnTypeToString(columnType::ordinal), "." + columnTypeToString(columnType::nominal) };
+
+	return suffixes[typeIndex];
+}
+
+columnType ColumnEncoding::typeFromIndex(size_t typeIndex)
+{
+	static const columnType types[] = { columnType::scale, columnType::ordinal, columnType::nominal };
+
+	return types[typeIndex];
+}
+
+size_t ColumnEncoding::indexFromType(columnType colType)
+{
+	return colType == columnType::scale ? 0 : colType == columnType::ordinal ? 1 : 2;
+}
+
+uint32_t ColumnEncoding::typedId(size_t col, columnType colType)
+{
+	size_t		typeIndex	= indexFromType(colType);
+	uint32_t	typed		= _names.intern(std::string(_names.name(_originalIds[col])) + typeSuffix(typeIndex)),
+				encoded		= _names.encodedId(typed);
+
+	if(encoded != ColumnNameIndex::noId && _names.type(encoded) == colType) //Already there
+		return typed;
+
+	encoded = _names.intern(encodedName(encodedCounter(col, typeIndex)));
+
+	_names.setEncoded(typed, encoded); //Just like always, if some other column happens to be called "name.scale" this one wins.
+	_names.setDecoded(encoded, _originalIds[col], colType); //Decoding is back to the actual name in the data!
+
+	return typed;
+}
+
+void ColumnEncoding::decodeDifferently(const std::map<std::string, std::string> & decodeDifferently)
+{
+	//The typed names need to be in _names for this, otherwise they are simply decoded from their counter
+	std::vector<uint32_t> encodedIds(_encodedIds.begin(), _encodedIds.end());
+
+	if(_typesEncoded)
+		for(size_t col = 0; col < _originalIds.size(); col++)
+			if(_originalIds[col] != ColumnNameIndex::noId)
+				for(columnType colType : { columnType::scale, columnType::ordinal, columnType::nominal })
+					encodedIds.push_back(_names.encodedId(typedId(col, colType)));
+
+	for(uint32_t encoded : encodedIds)
+		if(encoded != ColumnNameIndex::noId)
+		{
+			auto differently = decodeDifferently.find(std::string(_names.name(_names.decodedId(encoded))));
+
+			if(differently != decodeDifferently.end())
+				_names.setDecoded(encoded, _names.intern(differently->second), _names.type(encoded));
+		}
+}
+
+bool ColumnEncoding::findEncoded(std::string_view name, std::string & encoded) const
+{
+	if(_typesEncoded)
+		for(size_t typeIndex = 0; typeIndex < 3; typeIndex++)
+		{
+			const std::string & suffix = typeSuffix(typeIndex);
+
+			if(name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+			{
+				uint32_t original = _names.find(name.substr(0, name.size() - suffix.size()));
+
+				if(original != ColumnNameIndex::noId && _names.column(original) != ColumnNameIndex::noId)
+				{
+					encoded = encodedName(encodedCounter(_names.column(original), typeIndex));
+					return true;
+				}
+			}
+		}
+
+	std::string_view plain;
+
+	if(!_names.findEncoded(name, plain))
+		return false;
+
+	encoded = plain;
+	return true;
+}
+
+bool ColumnEncoding::findDecoded(std::string_view name, std::string_view & decoded, columnType * type) const
+{
+	if(_names.findDecoded(name, decoded, type))
+		return true;
+
+	//The typed ones can be decoded from their counter, no need to add them to _names
+	size_t	counter,
+			col;
+	int		typeIndex;
+
+	if(!_typesEncoded || !counterOf(name, counter) || !columnFromCounter(counter, col, typeIndex) || typeIndex < 0)
+		return false;
+
+	decoded = _names.name(_originalIds[col]);
+
+	if(type)
+		*type = typeFromIndex(typeIndex);
+
+	return true;
+}
+
+void ColumnEncoding::collectEncodings(NameList & list) const
+{
+	//The typed names go first, they win from a column that happens to be called "name.scale" as well
+	if(_typesEncoded)
+		for(size_t col = 0; col < _originalIds.size(); col++)
+			if(_originalIds[col] != ColumnNameIndex::noId && _names.column(_originalIds[col]) == col) //If a name occurs more than once the last one wins
+				for(size_t typeIndex = 0; typeIndex < 3; typeIndex++)
+				{
+					list.names			.push_back(std::string(_names.name(_originalIds[col])) + typeSuffix(typeIndex));
+					list.replacements	.push_back(encodedName(encodedCounter(col, typeIndex)));
+				}
+
+	for(uint32_t original : _originalIds)
+		if(original != ColumnNameIndex::noId && _names.encodedId(original) != ColumnNameIndex::noId)
+		{
+			list.names			.push_back(std::string(_names.name(original)));
+			list.replacements	.push_back(std::string(_names.name(_names.encodedId(original))));
+		}
+}
+
+void ColumnEncoding::collectDecodings(NameList & list) const
+{
+	for(uint32_t encoded : _encodedIds)
+		if(encoded != ColumnNameIndex::noId)
+		{
+			list.names			.push_back(std::string(_names.name(encoded)));
+			list.replacements	.push_back(std::string(_names.name(_names.decodedId(encoded))));
+		}
+
+	if(_typesEncoded)
+		for(size_t col = 0; col < _originalIds.size(); col++)
+			if(_originalIds[col] != ColumnNameIndex::noId)
+				for(size_t typeIndex = 0; typeIndex < 3; typeIndex++)
+				{
+					std::string			encoded = encodedName(encodedCounter(col, typeIndex));
+					std::string_view	decoded;
+
+					findDecoded(encoded, decoded);
+
+					list.names			.push_back(encoded);
+					list.replacements	.push_back(std::string(decoded));
+				}
+}
+
+void ColumnEncoding::collectAffected(const std::string & name, colVec & encodingKeys, colVec & decodingKeys) const
+{
+	encodingKeys.push_back(name);
+
+	if(_typesEncoded)
+		for(size_t typeIndex = 0; typeIndex < 3; typeIndex++)
+			encodingKeys.push_back(name + typeSuffix(typeIndex));
+
+	uint32_t original = _names.find(name);
+
+	if(original == ColumnNameIndex::noId || _names.column(original) == ColumnNameIndex::noId)
+		return;
+
+	for(size_t slot : slotsOf(original, _names.column(original)))
+	{
+		decodingKeys.push_back(std::string(_names.name(_encodedIds[slot])));
+
+		if(_typesEncoded)
+			for(size_t typeIndex = 0; typeIndex < 3; typeIndex++)
+				decodingKeys.push_back(encodedName(encodedCounter(slot, typeIndex)));
+	}
+}
+
+ColumnEncoding::colVec ColumnEncoding::allOriginalNames() const
+{
+	colVec names;
+	names.reserve(_originalIds.size() * (_typesEncoded ? 4 : 1));
+
+	for(uint32_t original : _originalIds)
+		if(original != ColumnNameIndex::noId)
+			names.push_back(std::string(_names.name(original)));
+
+	if(_typesEncoded)
+		for(uint32_t original : _originalIds)
+			if(original != ColumnNameIndex::noId)
+				for(size_t typeIndex = 0; typeIndex < 3; typeIndex++)
+					names.push_back(std::string(_names.name(original)) + typeSuffix(typeIndex));
+
+	return names;
+}
+
+ColumnEncoding::colVec ColumnEncoding::allEncodedNames() const
+{
+	colVec	names;
+	size_t	col;
+	int		typeIndex;
+
+	names.reserve(_encodedIds.size() * (_typesEncoded ? 4 : 1));
+
+	for(size_t counter = 0; counter < _encodedIds.size() * (_typesEncoded ? 4 : 1); counter++)
+		if(columnFromCounter(counter, col, typeIndex))
+			names.push_back(encodedName(counter));
+
+	return names;
+}
+
+static const uint32_t	serializationMagic		= 0x4A434530, //"JCE0", also shows whether the byte order is the same
+						serializationVersion	= 2;
+
+void ColumnEncoding::write(BinaryWriter & writer) const
+{
+	writer.write(serializationMagic);
+	writer.write(serializationVersion);
+	writer.write(_encodePrefix);
+	writer.write(_encodePostfix);
+	writer.write(uint8_t(_typesEncoded));
+	writer.write(uint64_t(_firstColumns));
+	_originalIds.write(writer);
+	_encodedIds	.write(writer);
+	_names.write(writer);
+}
+
+bool ColumnEncoding::read(BinaryReader & reader, std::shared_ptr<const void> viewedFrom)
+{
+	uint32_t	magic,
+				version;
+	uint64_t	firstColumns;
+	uint8_t		typesEncoded;
+
+	std::vector<uint32_t>	originalIds,
+							encodedIds;
+
+	bool ok =	reader.read(magic)			&& magic	== serializationMagic
+			&&	reader.read(version)		&& version	== serializationVersion
+			&&	reader.read(_encodePrefix)
+			&&	reader.read(_encodePostfix)
+			&&	reader.read(typesEncoded)		&& typesEncoded <= 1
+			&&	reader.read(firstColumns)
+			&&	reader.read(originalIds)
+			&&	reader.read(encodedIds)
+			&&	(viewedFrom ? _names.view(reader, viewedFrom) : _names.read(reader))
+			&&	originalIds.size() == encodedIds.size()
+			&&	firstColumns <= originalIds.size();
+
+	_originalIds.assign(originalIds.data(),	originalIds.size());
+	_encodedIds	.assign(encodedIds.data(),	encodedIds.size());
+
+	for(size_t col = 0; ok && col < _originalIds.size(); col++)
+		ok =	(_originalIds[col]	== ColumnNameIndex::noId || _originalIds[col]	< _names.size())
+			&&	(_encodedIds[col]	== ColumnNameIndex::noId || _encodedIds[col]	< _names.size());
+
+	for(uint32_t id = 0; ok && id < _names.size(); id++)
+		ok = _names.column(id) == ColumnNameIndex::noId || _names.column(id) < _originalIds.size();
+
+	if(!ok)
+	{
+		_names.clear();
+		_originalIds.clear();
+		_encodedIds.clear();
+		_firstColumns = 0;
+		return false;
+	}
+
+	_typesEncoded	= typesEncoded;
+	_firstColumns	= firstColumns;
+	_duplicates		= false;
+
+	for(size_t col = 0; col < _originalIds.size(); col++)
+		if(_originalIds[col] != ColumnNameIndex::noId && _names.column(_originalIds[col]) != col)
+			_duplicates = true;
+
+	return true;
+}
@@ -0,0 +1,102 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef COLUMNENCODING_H
+#define COLUMNENCODING_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include "columntype.h"
+#include "columnnameindex.h"
+#include "binaryserialization.h"
+#include "sharedpages.h"
+
+/// The columns of one ColumnEncoder and what they are encoded to.
+/// ColumnEncoder never changes one it has handed out, it changes a copy and swaps that in instead.
+/// So a ColumnEncoderSnapshot can just keep a pointer to it and read it from any thread.
+/// The tables are in SharedPages, so such a copy shares everything with the original except for the few pages that change.
+class ColumnEncoding
+{
+public:
+	typedef std::vector<std::string>				colVec;
+	typedef std::shared_ptr<const ColumnEncoding>	Ptr;
+
+	struct NameList
+	{
+		colVec	names,
+				replacements; ///< What names[i] gets en- or decoded to
+	};
+
+								ColumnEncoding(const std::string & prefix, const std::string & postfix) : _encodePrefix(prefix), _encodePostfix(postfix) {}
+
+			void				setNames(const colVec & names, bool generateTypesEncoding);
+			void				addColumns(const colVec & names);
+			void				removeColumns(const colVec & names);
+			void				renameColumn(const std::string & oldName, const std::string & newName);
+
+			///Makes the encoded names (typed ones too) of the columns in decodeDifferently decode to what they are mapped to instead of the column itself.
+			void				decodeDifferently(const std::map<std::string, std::string> & decodeDifferently);
+
+			///The typed names are not stored but worked out from the column, which is why encoded has to be a string.
+			bool				findEncoded(std::string_view name, std::string		& encoded)								const;
+			bool				findDecoded(std::string_view name, std::string_view	& decoded, columnType * type = nullptr)	const;
+
+			void				collectEncodings(NameList & list) const; ///< Typed names first
+			void				collectDecodings(NameList & list) const;
+
+			///Adds every name that might en- or decode differently once the column called name is added, removed or renamed. Ask the encoding that has that column.
+			void				collectAffected(const std::string & name, colVec & encodingKeys, colVec & decodingKeys) const;
+			colVec				allOriginalNames() const;
+			colVec				allEncodedNames() const; ///< By counter
+
+			///Everything, as raw as possible, so that another process of the same build can read it back without working anything out again.
+			void				write(BinaryWriter & writer) const;
+			bool				read(BinaryReader & reader, std::shared_ptr<const void> viewedFrom = nullptr); ///< False if it isn't something write made, then this is left empty. With viewedFrom the name tables are used where they are, see ColumnNameIndex::view.
+
+			bool				empty()		const { return _encodedIds.empty();	}
+	const	std::string		&	prefix()	const { return _encodePrefix;		}
+	const	std::string		&	postfix()	const { return _encodePostfix;		}
+
+private:
+			void				addColumn(const std::string & name);
+			bool				columnExists(const std::string & name) const;
+			void				forgetTypedNames(uint32_t original);
+			size_t				encodedCounter(size_t col, int typeIndex = -1) const; ///< typeIndex -1 is the plain name
+			bool				columnFromCounter(size_t counter, size_t & col, int & typeIndex) const;
+			std::string			encodedName(size_t counter) const;
+			bool				counterOf(std::string_view name, size_t & counter) const;
+			std::vector<size_t>	slotsOf(uint32_t original, size_t col) const; ///< All columns called original, which is only more than col if there are duplicates
+	static	const std::string &	typeSuffix(size_t typeIndex);
+	static	columnType			typeFromIndex(size_t typeIndex);
+	static	size_t				indexFromType(columnType colType);
+			uint32_t			typedId(size_t col, columnType colType); ///< Adds the typed name to _names if it isn't there yet
+
+	ColumnNameIndex				_names;			///< Every original and encoded name, each stored once. Typed ones only when they decode differently.
+	SharedPages<uint32_t>		_originalIds,	///< Into _names, by column. Removed columns are noId.
+								_encodedIds;
+	bool						_typesEncoded = false;
+	size_t						_firstColumns = 0;	///< How many columns setNames got, the rest was added later
+	bool						_duplicates = false;	///< Whether some name is in _originalIds more than once
+
+	std::string					_encodePrefix,
+								_encodePostfix;
+};
+
+#endif // COLUMNENCODING_H
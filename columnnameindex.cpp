@@ -0,0 +1,229 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "columnnameindex.h"
+#include <algorithm>
+
+void ColumnNameIndex::clear()
+{
+	_chars	.clear();
+	_names	.clear();
+	_slots	.clear();
+}
+
+void ColumnNameIndex::reserve(size_t names, size_t chars)
+{
+	_names	.reserve(names);
+	_chars	.reserve(chars);
+
+	size_t slots = 16;
+	while(slots < names * 2)
+		slots *= 2;
+
+	if(slots > _slots.size())
+		rehash(slots);
+}
+
+uint32_t ColumnNameIndex::hash(std::string_view name)
+{
+	//FNV-1a, simple and good enough for names
+	uint32_t h = 2166136261u;
+
+	for(unsigned char kar : name)
+		h = (h ^ kar) * 16777619u;
+
+	return h;
+}
+
+bool ColumnNameIndex::lookup(std::string_view name, uint32_t nameHash, size_t & slot) const
+{
+	const size_t mask = _slots.size() - 1;
+
+	for(slot = nameHash & mask; _slots[slot] != 0; slot = (slot + 1) & mask)
+	{
+		const Name & other = _names[_slots[slot] - 1];
+
+		if(other.hash == nameHash && _chars.chars().substr(other.begin, other.length) == name)
+			return true;
+	}
+
+	return false;
+}
+
+void ColumnNameIndex::rehash(size_t slots)
+{
+	_slots.assign(slots, 0);
+
+	const size_t mask = slots - 1;
+
+	for(size_t id=0; id<_names.size(); id++)
+	{
+		size_t slot = _names[id].hash & mask;
+
+		while(_slots[slot] != 0)
+			slot = (slot + 1) & mask;
+
+		_slots.edit(slot) = id + 1;
+	}
+}
+
+uint32_t ColumnNameIndex::intern(std::string_view name)
+{
+	if((_names.size() + 1) * 2 > _slots.size())
+		rehash(std::max(size_t(16), _slots.size() * 2));
+
+	uint32_t	nameHash = hash(name);
+	size_t		slot;
+
+	if(lookup(name, nameHash, slot))
+		return _slots[slot] - 1;
+
+	Name added;
+	added.hash		= nameHash;
+	added.begin		= _chars.size();
+	added.length	= name.size();
+
+	_chars.append(name);
+	_names.push_back(added);
+
+	_slots.edit(slot) = _names.size();
+
+	return _names.size() - 1;
+}
+
+uint32_t ColumnNameIndex::find(std::string_view name) const
+{
+	size_t slot;
+
+	if(empty() || !lookup(name, hash(name), slot))
+		return noId;
+
+	return _slots[slot] - 1;
+}
+
+bool ColumnNameIndex::findEncoded(std::string_view name, std::string_view & encoded) const
+{
+	uint32_t id = find(name);
+
+	if(id == noId || encodedId(id) == noId)
+		return false;
+
+	encoded = this->name(encodedId(id));
+	return true;
+}
+
+bool ColumnNameIndex::findDecoded(std::string_view name, std::string_view & decoded, columnType * type) const
+{
+	uint32_t id = find(name);
+
+	if(id == noId || decodedId(id) == noId)
+		return false;
+
+	decoded = this->name(decodedId(id));
+
+	if(type)
+		*type = this->type(id);
+
+	return true;
+}
+
+void ColumnNameIndex::write(BinaryWriter & writer) const
+{
+	writer.write(uint32_t(sizeof(Name)));
+	writer.write(_chars.chars());
+	_names.write(writer);
+	_slots.write(writer);
+}
+
+bool ColumnNameIndex::read(BinaryReader & reader)
+{
+	uint32_t				nameSize;
+	std::string				chars;
+	std::vector<Name>		names;
+	std::vector<uint32_t>	slots;
+
+	clear();
+
+	bool ok =	reader.read(nameSize) && nameSize == sizeof(Name)
+			&&	reader.read(chars)
+			&&	reader.read(names)
+			&&	reader.read(slots);
+
+	//The data doesn't have to be aligned, so it has to be copied out of there anyway
+	_chars.assign(chars);
+	_names.assign(names.data(), names.size());
+	_slots.assign(slots.data(), slots.size());
+
+	if(!ok || !valid())
+	{
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool ColumnNameIndex::view(BinaryReader & reader, std::shared_ptr<const void> keepAlive)
+{
+	uint32_t			nameSize;
+	std::string_view	chars;
+	const Name		*	names	= nullptr;
+	const uint32_t	*	slots	= nullptr;
+	size_t				namesCount,
+						slotsCount;
+
+	clear();
+
+	if(!reader.read(nameSize) || nameSize != sizeof(Name) || !reader.view(chars) || !reader.view(names, namesCount) || !reader.view(slots, slotsCount))
+		return false;
+
+	_chars.view(chars,					keepAlive);
+	_names.view(names, namesCount,		keepAlive);
+	_slots.view(slots, slotsCount,		keepAlive);
+
+	if(!valid())
+	{
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool ColumnNameIndex::valid() const
+{
+	const size_t	namesCount	= _names.size(),
+					slotsCount	= _slots.size();
+
+	bool ok = slotsCount == 0 ? namesCount == 0 : (slotsCount & (slotsCount - 1)) == 0 && namesCount * 2 <= slotsCount;
+
+	//Everything that points somewhere is checked, so a broken file cannot make us read outside of what we have
+	for(size_t id = 0; ok && id < namesCount; id++)
+	{
+		const Name & name = _names[id];
+
+		ok =	size_t(name.begin) + name.length <= _chars.size()
+			&&	(name.encoded == noId || name.encoded < namesCount)
+			&&	(name.decoded == noId || name.decoded < namesCount)
+			&&	int(name.type) >= int(columnType::unknown) && int(name.type) <= int(columnType::nominalText);
+	}
+
+	for(size_t slot = 0; ok && slot < slotsCount; slot++)
+		ok = _slots[slot] <= namesCount;
+
+	return ok;
+}
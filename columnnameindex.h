@@ -0,0 +1,101 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef COLUMNNAMEINDEX_H
+#define COLUMNNAMEINDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include "columntype.h"
+#include "binaryserialization.h"
+#include "sharedpages.h"
+
+/// Stores every name (original, typed and encoded) only once and gives each a stable 32-bit id, those stay the same until clear().
+/// An id can point to the id of its encoded and/or decoded name, the latter with a columnType, so ColumnEncoder can en- and decode using only ids.
+/// All names are stored one after the other in SharedChars and the hashtable itself uses open addressing in SharedPages,
+/// so there are no allocations per name and lookups can be done with a std::string_view without making a std::string first.
+/// A copy shares all of that with the original, changing it afterwards only copies the pages that change. That is what ColumnEncoder does every time a column is added, removed or renamed.
+/// The tables can also be used right where some other process wrote them, in shared memory for instance, see view(). Those pages too are only copied once something in them changes.
+class ColumnNameIndex
+{
+public:
+	static const uint32_t		noId = UINT32_MAX;
+
+								ColumnNameIndex() {}
+
+			void				clear();
+			void				reserve(size_t names, size_t chars = 0);
+
+			///Adds name if it isn't in there yet, either way its id is returned.
+			uint32_t			intern(std::string_view name);
+			uint32_t			find(std::string_view name) const; ///< noId if it isn't in there
+
+			///The views stay valid until the next intern.
+			std::string_view	name(		uint32_t id) const { return _chars.chars().substr(_names[id].begin, _names[id].length);	}
+			uint32_t			encodedId(	uint32_t id) const { return _names[id].encoded;	}
+			uint32_t			decodedId(	uint32_t id) const { return _names[id].decoded;	}
+			columnType			type(		uint32_t id) const { return _names[id].type;		}
+			uint32_t			column(		uint32_t id) const { return _names[id].column;	}
+
+			void				setEncoded(uint32_t id, uint32_t encoded)									{ _names.edit(id).encoded = encoded;									}
+			void				setDecoded(uint32_t id, uint32_t decoded, columnType type = columnType::unknown)	{ Name & name = _names.edit(id); name.decoded = decoded; name.type = type;	}
+			void				setColumn(uint32_t id, uint32_t column)										{ _names.edit(id).column = column;									}
+
+			///Look up what name en- or decodes to, false if it doesn't.
+			bool				findEncoded(std::string_view name, std::string_view & encoded) const;
+			bool				findDecoded(std::string_view name, std::string_view & decoded, columnType * type = nullptr) const;
+
+			bool				canEncode(std::string_view name) const { uint32_t id = find(name); return id != noId && encodedId(id) != noId; }
+			bool				canDecode(std::string_view name) const { uint32_t id = find(name); return id != noId && decodedId(id) != noId; }
+
+			size_t				size()	const { return _names.size();	}
+			bool				empty()	const { return _names.empty();	}
+
+			///Writes the whole table as it is, so reading it back is a couple of memcpys without hashing anything again.
+			void				write(BinaryWriter & writer) const;
+			bool				read(BinaryReader & reader); ///< False if it doesn't make sense, then the index is empty
+
+			///Like read, but the tables are used where they are instead of copied. Whatever they are in has to stay put as long as keepAlive lives, this index holds on to it until all of it has changed.
+			bool				view(BinaryReader & reader, std::shared_ptr<const void> keepAlive);
+			bool				isView() const { return _chars.isView() || _names.isView() || _slots.isView(); } ///< Whether some of it still is
+
+private:
+	struct Name
+	{
+		uint32_t	hash,
+					begin,
+					length,
+					encoded	= noId,
+					decoded	= noId,
+					column	= noId;	///< Which column this is the name of, if any
+		columnType	type	= columnType::unknown;
+	};
+
+	static	uint32_t			hash(std::string_view name);
+			bool				lookup(std::string_view name, uint32_t nameHash, size_t & slot) const;
+			void				rehash(size_t slots);
+			bool				valid() const; ///< Whether everything points to something that is there
+
+	SharedChars					_chars;
+	SharedPages<Name>			_names;	///< By id
+	SharedPages<uint32_t>		_slots;	///< 0 is empty, otherwise an id plus 1. Always a power of 2 and at most half full.
+};
+
+#endif // COLUMNNAMEINDEX_H
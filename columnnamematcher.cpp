@@ -0,0 +1,691 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "columnnamematcher.h"
+#include "workerpool.h"
+#include <algorithm>
+#include <cctype>
+#include <queue>
+#include <iterator>
+#include <stdexcept>
+
+void ColumnNameMatcher::clear()
+{
+	_nodes			.clear();
+	_edges			.clear();
+	_replacements	.clear();
+	_byCounter		.clear();
+	_prefix			.clear();
+	_postfix		.clear();
+	_commonPrefix	.clear();
+	_hidden			.clear();
+	_base			.reset();
+	_longestName	= 0;
+
+	_nodes.push_back(Node()); //The root
+	std::fill(std::begin(_rootEdges), std::end(_rootEdges), -1);
+}
+
+ColumnNameMatcher::ColumnNameMatcher(const colVec & names, const colMap & map, const std::string & prefix, const std::string & postfix)
+{
+	colViews	nameViews,
+				replacements;
+
+	nameViews	.reserve(names.size());
+	replacements.reserve(names.size());
+
+	for(const std::string & name : names)
+	{
+		nameViews	.push_back(name);
+		replacements.push_back(map.at(name));
+	}
+
+	build(nameViews, replacements, prefix, postfix);
+}
+
+ColumnNameMatcher::ColumnNameMatcher(const colViews & names, const colViews & replacements, const std::string & prefix, const std::string & postfix)
+{
+	build(names, replacements, prefix, postfix);
+}
+
+ColumnNameMatcher::ColumnNameMatcher(Ptr base, const colViews & changed, const colViews & names, const colViews & replacements, const std::string & prefix, const std::string & postfix)
+{
+	if(base && base->_base)
+		throw std::runtime_error("A ColumnNameMatcher can only be built on top of one that was built from scratch!");
+
+	build(names, replacements, prefix, postfix);
+
+	if(!base)
+		return;
+
+	_base = base;
+	_hidden.assign(_base->_replacements.size(), false);
+
+	//Whatever changed is hidden in the base, if it is still there it is one of our own names now
+	for(std::string_view name : changed)
+	{
+		int32_t index = _base->indexOf(name);
+
+		if(index != -1)
+			_hidden[index] = true;
+	}
+}
+
+int32_t ColumnNameMatcher::indexOf(std::string_view name) const
+{
+	Match match;
+
+	//The longest match at the start of name can only be name itself
+	if(name.empty() || !nextMatch(name, 0, match) || match.pos != 0 || match.length != name.size())
+		return -1;
+
+	return match.name;
+}
+
+void ColumnNameMatcher::build(const colViews & names, const colViews & replacements, const std::string & prefix, const std::string & postfix)
+{
+	clear();
+
+	if(initCounterFormat(names, replacements, prefix, postfix))
+		return;
+
+	//First build a plain trie, we flatten the edges afterwards so that matching stays nicely in the cache
+	std::vector<std::map<unsigned char, int32_t>> children(1);
+
+	for(size_t n = 0; n < names.size(); n++)
+	{
+		std::string_view name = names[n];
+
+		if(name.empty()) //An empty name would "match" everywhere
+			continue;
+
+		int32_t node = 0;
+
+		for(const char kar : name)
+		{
+			auto found = children[node].find(kar);
+
+			if(found != children[node].end())
+				node = found->second;
+			else
+			{
+				int32_t newNode = _nodes.size();
+				children[node][kar] = newNode;
+				children.push_back({});
+				_nodes.push_back(Node());
+				_nodes[newNode].depth = _nodes[node].depth + 1;
+				node = newNode;
+			}
+		}
+
+		if(_nodes[node].name == -1) //Names might occur more than once, if columnEncoders overlap for instance. Then the first one wins.
+		{
+			_nodes[node].name = _replacements.size();
+			_replacements.push_back(std::string(replacements[n]));
+			_longestName = std::max(_longestName, name.size());
+		}
+	}
+
+	//As long as the trie doesn't branch and no name ends all names share the path from the root
+	for(int32_t node = 0; children[node].size() == 1 && (node == 0 || _nodes[node].name == -1); node = children[node].begin()->second)
+		_commonPrefix.push_back(children[node].begin()->first);
+
+	for(size_t node = 0; node < children.size(); node++)
+	{
+		_nodes[node].edgesBegin = _edges.size();
+
+		for(const auto & karChild : children[node])
+			_edges.push_back(karChild);
+
+		_nodes[node].edgesEnd = _edges.size();
+	}
+
+	for(const auto & karChild : children[0])
+		_rootEdges[karChild.first] = karChild.second;
+
+	//Now add the failure links breadth-first, so that the fail of every parent is known before we get to its children
+	std::queue<int32_t> todo;
+	todo.push(0);
+
+	while(!todo.empty())
+	{
+		int32_t parent = todo.front();
+		todo.pop();
+
+		for(const auto & karChild : children[parent])
+		{
+			Node & node = _nodes[karChild.second];
+
+			node.fail	= parent == 0 ? 0 : step(_nodes[parent].fail, karChild.first);
+			node.output	= node.name != -1 ? karChild.second : _nodes[node.fail].output;
+
+			todo.push(karChild.second);
+		}
+	}
+}
+
+bool ColumnNameMatcher::initCounterFormat(const colViews & names, const colViews & replacements, const std::string & prefix, const std::string & postfix)
+{
+	//The postfix must not start with a digit, otherwise we cannot tell where the counter stops.
+	if(prefix.empty() || postfix.empty() || std::isdigit(static_cast<unsigned char>(postfix[0])))
+		return false;
+
+	std::vector<int32_t> byCounter;
+
+	for(size_t n = 0; n < names.size(); n++)
+	{
+		std::string_view name = names[n];
+
+		if(name.size() <= prefix.size() + postfix.size() || name.compare(0, prefix.size(), prefix) != 0 || name.compare(name.size() - postfix.size(), postfix.size(), postfix) != 0)
+			return false;
+
+		std::string_view digits = name.substr(prefix.size(), name.size() - prefix.size() - postfix.size());
+
+		if(digits.size() > 9 || !std::all_of(digits.begin(), digits.end(), [](unsigned char kar) { return std::isdigit(kar); }) || (digits[0] == '0' && digits.size() > 1))
+			return false;
+
+		size_t counter = 0;
+		for(char digit : digits)
+			counter = counter * 10 + (digit - '0');
+
+		if(counter > 4 * names.size() + 1024) //Something weird is going on and the vector would just be a waste of memory
+			return false;
+
+		if(byCounter.size() <= counter)
+			byCounter.resize(counter + 1, -1);
+
+		if(byCounter[counter] == -1)
+		{
+			byCounter[counter] = _replacements.size();
+			_replacements.push_back(std::string(replacements[n]));
+			_longestName = std::max(_longestName, name.size());
+		}
+	}
+
+	if(byCounter.empty())
+		return false;
+
+	_byCounter		= std::move(byCounter);
+	_prefix			= prefix;
+	_postfix		= postfix;
+	_commonPrefix	= prefix;
+
+	return true;
+}
+
+bool ColumnNameMatcher::nextCounterMatch(std::string_view text, size_t from, Match & match, size_t * undecidedFrom) const
+{
+	for(size_t pos = text.find(_prefix, from); pos != std::string_view::npos; pos = text.find(_prefix, pos + 1))
+	{
+		size_t	digits	= pos + _prefix.size(),
+				end		= digits,
+				counter	= 0;
+
+		while(end < text.size() && end - digits < 10 && std::isdigit(static_cast<unsigned char>(text[end])))
+			counter = counter * 10 + (text[end++] - '0');
+
+		//Text stops in the middle of the counter or postfix? Then we only know whether this is a name once the rest is in.
+		if(undecidedFrom && (end == text.size() || (text.size() - end < _postfix.size() && _postfix.compare(0, text.size() - end, text.substr(end)) == 0)))
+		{
+			*undecidedFrom = pos;
+			return false;
+		}
+
+		if(end == digits || (text[digits] == '0' && end - digits > 1) || counter >= _byCounter.size() || _byCounter[counter] == -1 || text.compare(end, _postfix.size(), _postfix) != 0)
+			continue;
+
+		match.pos		= pos;
+		match.length	= end + _postfix.size() - pos;
+		match.name		= _byCounter[counter];
+
+		return true;
+	}
+
+	if(undecidedFrom) //The prefix might have only just started at the end of text
+	{
+		*undecidedFrom = std::max(from, text.size() < _prefix.size() ? 0 : text.size() - _prefix.size() + 1);
+
+		while(*undecidedFrom < text.size() && _prefix.compare(0, text.size() - *undecidedFrom, text.substr(*undecidedFrom)) != 0)
+			(*undecidedFrom)++;
+	}
+
+	return false;
+}
+
+int32_t ColumnNameMatcher::child(int32_t node, unsigned char kar) const
+{
+	if(node == 0)
+		return _rootEdges[kar];
+
+	const Node & n = _nodes[node];
+
+	for(uint32_t e = n.edgesBegin; e < n.edgesEnd; e++)
+		if(_edges[e].first == kar)
+			return _edges[e].second;
+
+	return -1;
+}
+
+int32_t ColumnNameMatcher::step(int32_t node, unsigned char kar) const
+{
+	for(;;)
+	{
+		int32_t next = child(node, kar);
+
+		if(next != -1)	return next;
+		if(node == 0)	return 0;
+
+		node = _nodes[node].fail;
+	}
+}
+
+bool ColumnNameMatcher::nextMatch(std::string_view text, size_t from, Match & match) const
+{
+	return _base ? nextCombinedMatch(text, from, match, nullptr) : nextOwnMatch(text, from, match, nullptr);
+}
+
+bool ColumnNameMatcher::nextMatchSoFar(std::string_view text, size_t from, Match & match, size_t & undecidedFrom) const
+{
+	return _base ? nextCombinedMatch(text, from, match, &undecidedFrom) : nextOwnMatch(text, from, match, &undecidedFrom);
+}
+
+bool ColumnNameMatcher::nextOwnMatch(std::string_view text, size_t from, Match & match, size_t * undecidedFrom) const
+{
+	if(_replacements.empty())
+	{
+		if(undecidedFrom)
+			*undecidedFrom = text.size();
+
+		return false;
+	}
+
+	return counterFormat() ? nextCounterMatch(text, from, match, undecidedFrom) : nextAutomatonMatch(text, from, match, undecidedFrom);
+}
+
+bool ColumnNameMatcher::longestVisibleBaseMatchAt(std::string_view text, size_t pos, Match & match) const
+{
+	static thread_local std::vector<Match> atPos;
+
+	_base->matchesAt(text, pos, atPos);
+
+	for(auto longer = atPos.rbegin(); longer != atPos.rend(); longer++)
+		if(!hidden(longer->name))
+		{
+			match		= *longer;
+			match.name	+= _replacements.size();
+			return true;
+		}
+
+	return false;
+}
+
+bool ColumnNameMatcher::nextBaseMatch(std::string_view text, size_t from, Match & match, size_t * undecidedFrom) const
+{
+	for(;;)
+	{
+		if(!(undecidedFrom ? _base->nextMatchSoFar(text, from, match, *undecidedFrom) : _base->nextMatch(text, from, match)))
+			return false;
+
+		if(!hidden(match.name))
+		{
+			match.name += _replacements.size();
+			return true;
+		}
+
+		//The longest name here has changed, but a shorter one that starts here might still be there. Otherwise the next one might start inside of the changed one.
+		if(longestVisibleBaseMatchAt(text, match.pos, match))
+			return true;
+
+		from = match.pos + 1;
+	}
+}
+
+bool ColumnNameMatcher::nextCombinedMatch(std::string_view text, size_t from, Match & match, size_t * undecidedFrom) const
+{
+	Match	own,
+			base;
+	size_t	ownUndecidedFrom	= text.size(),
+			baseUndecidedFrom	= text.size();
+	bool	foundOwn			= nextOwnMatch(	text, from, own,	undecidedFrom ? &ownUndecidedFrom	: nullptr),
+			foundBase			= nextBaseMatch(text, from, base,	undecidedFrom ? &baseUndecidedFrom	: nullptr);
+
+	//While streaming one of them might not be sure yet about something that starts before what the other found
+	if(undecidedFrom && ((foundOwn && !foundBase && baseUndecidedFrom <= own.pos) || (foundBase && !foundOwn && ownUndecidedFrom <= base.pos) || (!foundOwn && !foundBase)))
+	{
+		*undecidedFrom = std::min(foundOwn ? baseUndecidedFrom : ownUndecidedFrom, foundBase ? ownUndecidedFrom : baseUndecidedFrom);
+		return false;
+	}
+
+	if(!foundOwn && !foundBase)
+		return false;
+
+	match = !foundBase || (foundOwn && better(own, base)) ? own : base;
+	return true;
+}
+
+bool ColumnNameMatcher::nextAutomatonMatch(std::string_view text, size_t from, Match & match, size_t * undecidedFrom) const
+{
+	bool	found	= false;
+	int32_t	node	= 0;
+
+	for(size_t pos = from; pos < text.size(); pos++)
+	{
+		node = step(node, text[pos]);
+
+		//Check every name that ends here, from long to short, and keep the one that starts first
+		for(int32_t out = _nodes[node].output; out != -1; out = _nodes[_nodes[out].fail].output)
+		{
+			size_t	length	= _nodes[out].depth,
+					start	= pos + 1 - length;
+
+			if(!found || start < match.pos || (start == match.pos && length > match.length))
+			{
+				found			= true;
+				match.pos		= start;
+				match.length	= length;
+				match.name		= _nodes[out].name;
+			}
+		}
+
+		//Anything we might still find from here on starts at or after pos + 1 - depth, so if that is after our match it is the one.
+		if(found && pos + 1 - _nodes[node].depth > match.pos)
+			return true;
+	}
+
+	if(undecidedFrom) //Without the rest of the text we cannot be sure there is no longer or earlier match
+	{
+		*undecidedFrom = std::max(from, text.size() - _nodes[node].depth);
+		return false;
+	}
+
+	return found;
+}
+
+void ColumnNameMatcher::matchesAt(std::string_view text, size_t pos, std::vector<Match> & matches) const
+{
+	matches.clear();
+
+	if(_base)
+	{
+		_base->matchesAt(text, pos, matches);
+
+		matches.erase(std::remove_if(matches.begin(), matches.end(), [&](const Match & match) { return hidden(match.name); }), matches.end());
+
+		for(Match & match : matches)
+			match.name += _replacements.size();
+	}
+
+	if(counterFormat())
+		return;
+
+	size_t fromBase = matches.size();
+
+	Match match;
+	match.pos = pos;
+
+	//No failure links here, we just follow the trie as far as text lets us
+	for(int32_t node = 0; pos < text.size() && (node = child(node, text[pos])) != -1; pos++)
+		if(_nodes[node].name != -1)
+		{
+			match.length	= _nodes[node].depth;
+			match.name		= _nodes[node].name;
+			matches.push_back(match);
+		}
+
+	//Both are from short to long already
+	std::inplace_merge(matches.begin(), matches.begin() + fromBase, matches.end(), [](const Match & a, const Match & b) { return a.length < b.length; });
+}
+
+void ColumnNameMatcher::findAll(std::string_view text, std::vector<Match> & matches) const
+{
+	matches.clear();
+
+	Match match;
+
+	if(!_base)
+	{
+		for(size_t from = 0; nextMatch(text, from, match); from = match.pos + match.length)
+			matches.push_back(match);
+
+		return;
+	}
+
+	//Whatever the base or our own names found after the last match is still the next one for them, so only the one that was used has to be looked for again
+	Match	own,
+			base;
+	bool	foundOwn	= nextOwnMatch(	text, 0, own,	nullptr),
+			foundBase	= nextBaseMatch(text, 0, base,	nullptr);
+
+	while(foundOwn || foundBase)
+	{
+		match = !foundBase || (foundOwn && better(own, base)) ? own : base;
+		matches.push_back(match);
+
+		const size_t from = match.pos + match.length;
+
+		if(foundOwn		&& own.pos	< from)	foundOwn	= nextOwnMatch(	text, from, own,	nullptr);
+		if(foundBase	&& base.pos	< from)	foundBase	= nextBaseMatch(text, from, base,	nullptr);
+	}
+}
+
+void ColumnNameMatcher::collectCandidates(std::string_view text, size_t from, size_t to, std::vector<Match> & candidates) const
+{
+	if(!_base)
+	{
+		collectOwnCandidates(text, from, to, candidates);
+		return;
+	}
+
+	std::vector<Match> own, base;
+
+	collectOwnCandidates(text, from, to, own);
+	_base->collectCandidates(text, from, to, base);
+
+	//A changed name in the base might still have a shorter one starting at the same position
+	size_t visible = 0;
+	for(Match & candidate : base)
+		if(!hidden(candidate.name))
+		{
+			base[visible]		= candidate;
+			base[visible].name	+= _replacements.size();
+			visible++;
+		}
+		else if(longestVisibleBaseMatchAt(text, candidate.pos, base[visible]))
+			visible++;
+
+	base.resize(visible);
+
+	//Both have at most one per position and are ordered, so merging them and keeping the longest for each position is all there is left to do
+	candidates.clear();
+	std::merge(own.begin(), own.end(), base.begin(), base.end(), std::back_inserter(candidates), better);
+	candidates.erase(std::unique(candidates.begin(), candidates.end(), [](const Match & a, const Match & b) { return a.pos == b.pos; }), candidates.end());
+}
+
+void ColumnNameMatcher::collectOwnCandidates(std::string_view text, size_t from, size_t to, std::vector<Match> & candidates) const
+{
+	if(_replacements.empty())
+		return;
+
+	Match candidate;
+
+	//Names starting before "to" can stick out of the chunk by at most the length of the longest name
+	size_t	scanUpTo	= std::min(text.size(), to + _longestName - 1);
+	int32_t	node		= 0;
+
+	if(counterFormat()) //Every occurence of the prefix is either a name or it isn't. Looking further than the overlap is pointless, and would make every chunk go through the rest of the text.
+	{
+		std::string_view chunk = text.substr(0, scanUpTo);
+
+		for(size_t pos = from; pos < to && nextCounterMatch(chunk, pos, candidate, nullptr) && candidate.pos < to; pos = candidate.pos + 1)
+			candidates.push_back(candidate);
+
+		return;
+	}
+
+	for(size_t pos = from; pos < scanUpTo; pos++)
+	{
+		node = step(node, text[pos]);
+
+		if(pos + 1 - _nodes[node].depth >= to)
+		{
+			if(pos >= to)
+				break;
+
+			continue;
+		}
+
+		for(int32_t out = _nodes[node].output; out != -1; out = _nodes[_nodes[out].fail].output)
+		{
+			candidate.length	= _nodes[out].depth;
+			candidate.pos		= pos + 1 - candidate.length;
+			candidate.name		= _nodes[out].name;
+
+			if(candidate.pos < to)
+				candidates.push_back(candidate);
+		}
+	}
+
+	//Now we only need the longest name for each position
+	std::sort(candidates.begin(), candidates.end(), [](const Match & a, const Match & b) { return a.pos < b.pos || (a.pos == b.pos && a.length > b.length); });
+	candidates.erase(std::unique(candidates.begin(), candidates.end(), [](const Match & a, const Match & b) { return a.pos == b.pos; }), candidates.end());
+}
+
+void ColumnNameMatcher::findAllParallel(std::string_view text, std::vector<Match> & matches, size_t threads) const
+{
+	//Just like replaceAll, most texts contain no names at all and then there is no need to split anything up
+	if(!mightMatch(text))
+	{
+		matches.clear();
+		return;
+	}
+
+	if(threads == 0)
+		threads = WorkerPool::pool().threads();
+
+	const size_t minimalChunk = 1 << 20;
+	threads = std::min(threads, text.size() / minimalChunk);
+
+	if(threads <= 1)
+	{
+		findAll(text, matches);
+		return;
+	}
+
+	//Every chunk gets the longest name starting at each of its positions, which can be done without knowing what came before.
+	std::vector<std::vector<Match>>	candidates(threads);
+	size_t							chunkSize = (text.size() + threads - 1) / threads;
+
+	WorkerPool::pool().run(threads, [&](size_t t)
+	{
+		collectCandidates(text, std::min(text.size(), t * chunkSize), std::min(text.size(), (t + 1) * chunkSize), candidates[t]);
+	});
+
+	//Then we go through all of them in order and take the first one starting after the previous match, which is exactly what nextMatch would have given us.
+	matches.clear();
+
+	size_t matchedUpTo = 0;
+	for(const std::vector<Match> & chunk : candidates)
+		for(const Match & candidate : chunk)
+			if(candidate.pos >= matchedUpTo)
+			{
+				matches.push_back(candidate);
+				matchedUpTo = candidate.pos + candidate.length;
+			}
+}
+
+bool ColumnNameMatcher::mightMatch(std::string_view text) const
+{
+	if(_base && _base->mightMatch(text)) //It doesn't know which names are hidden, but this is only a quick check anyway
+		return true;
+
+	if(_replacements.empty())
+		return false;
+
+	if(!_commonPrefix.empty())
+		return text.find(_commonPrefix) != std::string_view::npos;
+
+	for(const char kar : text)
+		if(_rootEdges[static_cast<unsigned char>(kar)] != -1)
+			return true;
+
+	return false;
+}
+
+std::string ColumnNameMatcher::replaceAll(std::string_view text) const
+{
+	std::string out;
+
+	if(!replaceAll(text, out))
+		return std::string(text);
+
+	return out;
+}
+
+std::string ColumnNameMatcher::replaceAllParallel(std::string_view text, size_t threads) const
+{
+	std::vector<Match> matches;
+	findAllParallel(text, matches, threads);
+
+	return replaceMatches(text, matches, [&](const Match & match) -> const std::string & { return replacement(match.name); });
+}
+
+bool ColumnNameMatcher::replaceAll(std::string_view text, std::string & out) const
+{
+	static thread_local std::vector<Match> matches; //Kept around so that we do not need to allocate it for every text
+
+	if(!mightMatch(text))
+		return false;
+
+	findAll(text, matches);
+
+	if(matches.empty())
+		return false;
+
+	out = replaceMatches(text, matches, [&](const Match & match) -> const std::string & { return replacement(match.name); });
+
+	return true;
+}
+
+std::string ColumnNameStreamReplacer::feed(const std::string & chunk)
+{
+	_pending.append(chunk);
+
+	std::string					out;
+	size_t						copiedUpTo		= 0,
+								undecidedFrom	= 0;
+	ColumnNameMatcher::Match	match;
+
+	for(size_t from = 0; _matcher->nextMatchSoFar(_pending, from, match, undecidedFrom); from = match.pos + match.length)
+	{
+		out.append(_pending, copiedUpTo, match.pos - copiedUpTo);
+		out.append(_matcher->replacement(match.name));
+		copiedUpTo = match.pos + match.length;
+	}
+
+	out.append(_pending, copiedUpTo, undecidedFrom - copiedUpTo);
+	_pending.erase(0, undecidedFrom);
+
+	return out;
+}
+
+std::string ColumnNameStreamReplacer::finish()
+{
+	std::string out = _matcher->replaceAll(_pending);
+	_pending.clear();
+
+	return out;
+}
@@ -0,0 +1,214 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef COLUMNNAMEMATCHER_H
+#define COLUMNNAMEMATCHER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <memory>
+#include <algorithm>
+
+/// Finds all the names it was built from in a text in a single pass, using an Aho-Corasick automaton.
+/// Matches are leftmost-longest and never overlap, which is exactly what ColumnEncoder::replaceAll used to get by
+/// searching for every name (sorted from big to small) over and over again.
+///
+/// If all names are of the form prefix + counter + postfix, as ColumnEncoder::setCurrentNames makes them, it can be told so.
+/// It then skips the automaton and just looks for the prefix, parses the counter and takes the replacement from a vector.
+///
+/// It can also be built on top of another one, so that after adding or removing a couple of names not everything has to be built again.
+/// It then finds the names of that base, except for those it was told have changed, plus its own. Those are searched separately and the results combined.
+class ColumnNameMatcher
+{
+public:
+	typedef std::map<std::string, std::string>	colMap;
+	typedef std::vector<std::string>			colVec;
+	typedef std::vector<std::string_view>		colViews;
+	typedef std::shared_ptr<const ColumnNameMatcher>	Ptr;
+
+	struct Match
+	{
+		size_t	pos		= 0,
+				length	= 0,
+				name	= 0; ///< For replacement()
+	};
+
+								ColumnNameMatcher() { clear(); }
+								ColumnNameMatcher(const colVec & names, const colMap & map, const std::string & prefix = "", const std::string & postfix = "");
+								ColumnNameMatcher(const colViews & names, const colViews & replacements, const std::string & prefix = "", const std::string & postfix = ""); ///< replacements[i] is what names[i] gets replaced by
+
+								///Finds what base does, except for the names in changed, plus names. Base cannot be built on top of something itself, so the changes have to be collected since it was.
+								ColumnNameMatcher(Ptr base, const colViews & changed, const colViews & names, const colViews & replacements, const std::string & prefix = "", const std::string & postfix = "");
+
+			void				clear();
+
+			///Looks for the first (and longest) name occurring in text at or after from.
+			bool				nextMatch(std::string_view text, size_t from, Match & match) const;
+
+			///Like nextMatch but for text that might still continue, as when streaming. If it cannot be sure about a match yet it returns false and sets undecidedFrom to where one might still start.
+			bool				nextMatchSoFar(std::string_view text, size_t from, Match & match, size_t & undecidedFrom) const;
+
+			///Collects every name that starts exactly at pos, from short to long, regardless of what comes before. Does nothing in counter format.
+			void				matchesAt(std::string_view text, size_t pos, std::vector<Match> & matches) const;
+
+			///Collects all matches in text in order, as nextMatch would find them one after the other.
+			void				findAll(std::string_view text, std::vector<Match> & matches) const;
+
+			///Same as findAll but spread over a number of threads (0 means as many as WorkerPool::pool() has), for very big texts. The matches are exactly the same.
+			void				findAllParallel(std::string_view text, std::vector<Match> & matches, size_t threads) const;
+
+			///Replace all occurences of the names in text by their replacement from the map given to the constructor.
+			std::string			replaceAll(std::string_view text) const;
+			std::string			replaceAllParallel(std::string_view text, size_t threads) const;
+
+			///Same as above, but if there is nothing to replace it returns false and leaves out alone, without allocating anything.
+			bool				replaceAll(std::string_view text, std::string & out) const;
+
+			///Same as above, but each replacement is put in out by appendReplacement(out, replacement), which could for instance escape it on the way.
+			template<typename AppendReplacement>
+			bool				replaceAll(std::string_view text, std::string & out, AppendReplacement appendReplacement) const
+			{
+				static thread_local std::vector<Match> matches;
+
+				if(!mightMatch(text))
+					return false;
+
+				findAll(text, matches);
+
+				if(matches.empty())
+					return false;
+
+				out.clear();
+				out.reserve(text.size());
+
+				size_t copiedUpTo = 0;
+				for(const Match & match : matches)
+				{
+					out.append(text, copiedUpTo, match.pos - copiedUpTo);
+					appendReplacement(out, replacement(match.name));
+					copiedUpTo = match.pos + match.length;
+				}
+
+				out.append(text, copiedUpTo, std::string::npos);
+
+				return true;
+			}
+
+			///Quick check that tells whether text could contain a name at all, by looking for the prefix all names share or otherwise for their first characters.
+			bool				mightMatch(std::string_view text) const;
+
+			///Builds text with every match replaced by replacementFor(match), matches must be ordered and may not overlap.
+			///The output is reserved at its exact size beforehand so this allocates only once, instead of shifting the tail of text around for every replacement.
+			template<typename ReplacementFor>
+	static	std::string			replaceMatches(std::string_view text, const std::vector<Match> & matches, ReplacementFor replacementFor)
+			{
+				if(matches.empty())
+					return std::string(text);
+
+				size_t outputSize = text.size();
+				for(const Match & match : matches)
+					outputSize += replacementFor(match).size() - match.length;
+
+				std::string out;
+				out.reserve(outputSize);
+
+				size_t copiedUpTo = 0;
+				for(const Match & match : matches)
+				{
+					out.append(text, copiedUpTo, match.pos - copiedUpTo);
+					out.append(replacementFor(match));
+					copiedUpTo = match.pos + match.length;
+				}
+
+				out.append(text, copiedUpTo, std::string::npos);
+
+				return out;
+			}
+
+			bool				empty()			const { return _replacements.empty() && !_base;	}
+			bool				counterFormat()	const { return !_byCounter.empty();					} ///< Of its own names, not those of the base
+			size_t				longestName()	const { return std::max(_longestName, _base ? _base->longestName() : 0);	}
+			size_t				size()			const { return _replacements.size() + (_base ? _base->size() : 0);			} ///< Including the hidden names of the base
+	const	std::string		&	replacement(size_t name) const { return name < _replacements.size() ? _replacements[name] : _base->replacement(name - _replacements.size()); }
+
+private:
+	struct Node
+	{
+		int32_t					fail		=  0,	///< Node of longest proper suffix of this node that is also in the trie
+								output		= -1,	///< This node or first node down the fail-chain where a name ends
+								name		= -1;	///< Index of name ending exactly here
+		uint32_t				depth		=  0,
+								edgesBegin	=  0,
+								edgesEnd	=  0;
+	};
+
+	typedef std::pair<unsigned char, int32_t> Edge;
+
+			void				build(const colViews & names, const colViews & replacements, const std::string & prefix, const std::string & postfix);
+			bool				initCounterFormat(const colViews & names, const colViews & replacements, const std::string & prefix, const std::string & postfix);
+			bool				nextOwnMatch(		std::string_view text, size_t from, Match & match, size_t * undecidedFrom) const;
+			bool				nextCounterMatch(	std::string_view text, size_t from, Match & match, size_t * undecidedFrom) const;
+			bool				nextAutomatonMatch(	std::string_view text, size_t from, Match & match, size_t * undecidedFrom) const;
+			void				collectCandidates(	std::string_view text, size_t from, size_t to, std::vector<Match> & candidates) const;
+			void				collectOwnCandidates(std::string_view text, size_t from, size_t to, std::vector<Match> & candidates) const;
+
+			//For when this is built on top of _base, the matches of the base get an index after those of our own names
+			bool				nextBaseMatch(		std::string_view text, size_t from, Match & match, size_t * undecidedFrom) const;
+			bool				nextCombinedMatch(	std::string_view text, size_t from, Match & match, size_t * undecidedFrom) const;
+			bool				longestVisibleBaseMatchAt(std::string_view text, size_t pos, Match & match) const;
+			bool				hidden(size_t baseName) const { return baseName < _hidden.size() && _hidden[baseName]; }
+			int32_t				indexOf(std::string_view name) const; ///< -1 if it isn't one of the names
+	static	bool				better(const Match & a, const Match & b) { return a.pos < b.pos || (a.pos == b.pos && a.length > b.length); } ///< Leftmost and then longest
+
+			int32_t				child(int32_t node, unsigned char kar) const;
+			int32_t				step(int32_t node, unsigned char kar) const;
+
+	std::vector<Node>			_nodes;
+	std::vector<Edge>			_edges;
+	int32_t						_rootEdges[256];
+	colVec						_replacements;
+	size_t						_longestName = 0;
+	std::string					_prefix,
+								_postfix,
+								_commonPrefix;		///< Shared by all names, can be empty of course
+	std::vector<int32_t>		_byCounter;			///< Index into _replacements for every counter, -1 if there is no such name
+	Ptr							_base;				///< If set its names are found as well, unless they are _hidden
+	std::vector<bool>			_hidden;			///< Names of _base that have changed, by their index there
+};
+
+/// Replaces names in a text that comes in chunk by chunk, for instance output of R while an analysis is still running.
+/// Anything at the end of a chunk that might still turn out to be (part of) a name is held back until the next chunk or finish().
+class ColumnNameStreamReplacer
+{
+public:
+								ColumnNameStreamReplacer(ColumnNameMatcher::Ptr matcher) : _matcher(matcher) {}
+
+			///Returns whatever can already be written out after adding chunk.
+			std::string			feed(const std::string & chunk);
+
+			///Returns the rest, after which this can be used for the next stream.
+			std::string			finish();
+
+private:
+	ColumnNameMatcher::Ptr		_matcher;
+	std::string					_pending;
+};
+
+#endif // COLUMNNAMEMATCHER_H
@@ -0,0 +1,184 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "optionsencodingplan.h"
+#include <algorithm>
+#include <cstring>
+
+OptionsEncodingPlan::Plans	OptionsEncodingPlan::_plans;
+std::mutex					OptionsEncodingPlan::_plansLock;
+const size_t				OptionsEncodingPlan::_plansMax = 64;
+
+OptionsEncodingPlan::OptionsEncodingPlan(const Json::Value & meta) : _meta(meta)
+{
+	compile(_meta);
+}
+
+OptionsEncodingPlan::Ptr OptionsEncodingPlan::forMeta(const Json::Value & meta)
+{
+	const size_t hash = hashOf(meta);
+
+	{
+		std::lock_guard<std::mutex> lock(_plansLock);
+
+		auto cached = _plans.find(hash);
+
+		if(cached != _plans.end() && cached->second->_meta == meta)
+			return cached->second;
+	}
+
+	Ptr plan = std::make_shared<const OptionsEncodingPlan>(meta); //Outside of the lock, it might throw if the meta is weird and then nothing gets cached
+
+	std::lock_guard<std::mutex> lock(_plansLock);
+
+	if(_plans.size() >= _plansMax) //There are only so many forms, so if there are this many something is generating metas and keeping them makes no sense
+		_plans.clear();
+
+	_plans[hash] = plan;
+
+	return plan;
+}
+
+size_t OptionsEncodingPlan::compile(const Json::Value & meta)
+{
+	const size_t index = _steps.size();
+	_steps.emplace_back();
+
+	std::vector<std::pair<std::string, size_t>> children;
+
+	switch(meta.type())
+	{
+	case Json::nullValue:
+		return index;
+
+	case Json::objectValue:
+		_steps[index].meta		= metaType::object;
+		_steps[index].encode	= meta.get("shouldEncode",	false).asBool();
+		_steps[index].rCode		= meta.get("rCode",			false).asBool();
+
+		for(Json::Value::const_iterator member = meta.begin(); member != meta.end(); member++)
+		{
+			const char	*	nameEnd,
+						*	nameBegin	= member.memberName(&nameEnd);
+			std::string		name		(nameBegin, nameEnd);
+
+			if(name != ".meta") //The options never look at their own meta
+				children.emplace_back(std::move(name), compile(*member));
+		}
+
+		std::sort(children.begin(), children.end());
+		break;
+
+	case Json::arrayValue:
+		_steps[index].meta = metaType::array;
+
+		for(const Json::Value & element : meta)
+			children.emplace_back("", compile(element));
+		break;
+
+	default:
+		_steps[index].meta = metaType::other;
+		return index;
+	}
+
+	//The children are added only now so that they end up next to each other instead of in between the steps of their own children
+	_steps[index].firstChild	= _children.size();
+	_steps[index].children		= children.size();
+
+	for(auto & nameStep : children)
+	{
+		_childNames	.push_back(std::move(nameStep.first));
+		_children	.push_back(nameStep.second);
+	}
+
+	return index;
+}
+
+const OptionsEncodingPlan::Step * OptionsEncodingPlan::member(const Step & step, std::string_view name) const
+{
+	if(step.meta != metaType::object)
+		return nullptr;
+
+	auto	begin	= _childNames.begin() + step.firstChild,
+			end		= begin + step.children,
+			found	= std::lower_bound(begin, end, name, [](const std::string & childName, std::string_view name) { return childName < name; });
+
+	return found != end && *found == name ? &_steps[_children[found - _childNames.begin()]] : nullptr;
+}
+
+size_t OptionsEncodingPlan::hashOf(const Json::Value & meta, size_t hash)
+{
+	//FNV-1a over the type and contents, it only has to be the same for equal metas because forMeta compares them anyway
+	auto mix = [&hash](const void * data, size_t size)
+	{
+		for(size_t i=0; i<size; i++)
+			hash = (hash ^ static_cast<const unsigned char *>(data)[i]) * 1099511628211ull;
+	};
+
+	const unsigned char type = meta.type();
+	mix(&type, 1);
+
+	switch(meta.type())
+	{
+	case Json::objectValue:
+		for(Json::Value::const_iterator member = meta.begin(); member != meta.end(); member++)
+		{
+			const char	*	nameEnd,
+						*	nameBegin = member.memberName(&nameEnd);
+
+			mix(nameBegin, nameEnd - nameBegin);
+			hash = hashOf(*member, hash);
+		}
+		break;
+
+	case Json::arrayValue:
+		for(const Json::Value & element : meta)
+			hash = hashOf(element, hash);
+		break;
+
+	case Json::stringValue:
+	{
+		const char	*	begin,
+					*	end;
+
+		if(meta.getString(&begin, &end))
+			mix(begin, end - begin);
+		break;
+	}
+
+	case Json::booleanValue:
+	{
+		const bool value = meta.asBool();
+		mix(&value, sizeof(bool));
+		break;
+	}
+
+	case Json::intValue:
+	case Json::uintValue:
+	case Json::realValue:
+	{
+		const double value = meta.asDouble(); //Equal numbers give equal doubles, that is all that is needed here
+		mix(&value, sizeof(double));
+		break;
+	}
+
+	default:
+		break;
+	}
+
+	return hash;
+}
@@ -0,0 +1,77 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef OPTIONSENCODINGPLAN_H
+#define OPTIONSENCODINGPLAN_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#ifdef BUILDING_JASP
+#include <json/json.h>
+#else
+#include "json/json.h"
+#endif
+
+/// The ".meta" of some analysis options worked out once into what ColumnEncoder::encodeColumnNamesinOptions should do where.
+/// A form sends the same ".meta" every time it is run, so instead of going through it with get and isMember every time the plan is made once and kept around by forMeta.
+/// Every step is what one (sub)meta said: whether to encode or treat it as R code and which steps belong to its members or elements.
+/// All steps are in one vector and those of the members of a step are next to each other, sorted by name, so finding one is a binary search without allocating anything.
+class OptionsEncodingPlan
+{
+public:
+	typedef std::shared_ptr<const OptionsEncodingPlan> Ptr;
+
+	enum class metaType { none, object, array, other }; ///< none is a null meta, other anything that isn't an object or array
+
+	struct Step
+	{
+		metaType	meta		= metaType::none;
+		bool		encode		= false,	///< "shouldEncode"
+					rCode		= false;	///< "rCode"
+		size_t		firstChild	= 0,		///< Into _children
+					children	= 0;
+	};
+
+								OptionsEncodingPlan(const Json::Value & meta);
+
+	static	Ptr					forMeta(const Json::Value & meta); ///< Gives the same plan for the same meta, only makes a new one if it hasn't seen the meta before
+
+	const	Step			&	root()											const { return _steps[0]; }
+	const	Step			*	member(const Step & step, std::string_view name)	const; ///< Null if there is no meta for that member
+	const	Step			&	element(const Step & step, size_t index)			const { return _steps[_children[step.firstChild + index]]; } ///< index < step.children
+
+private:
+			size_t				compile(const Json::Value & meta); ///< Returns the index of the step
+	static	size_t				hashOf(const Json::Value & meta, size_t hash = 14695981039346656037ull);
+
+	const Json::Value			_meta;			///< To be sure it is the same one and not just the same hash
+	std::vector<Step>			_steps;
+	std::vector<size_t>			_children;		///< Indices into _steps
+	std::vector<std::string>	_childNames;	///< Same order as _children, empty for elements of an array
+
+	typedef std::unordered_map<size_t, Ptr> Plans;
+
+	static	Plans				_plans;		///< By hash of the meta
+	static	std::mutex			_plansLock;
+	static	const size_t		_plansMax;
+};
+
+#endif // OPTIONSENCODINGPLAN_H
@@ -0,0 +1,302 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "rscriptnamereplacer.h"
+#include "workerpool.h"
+#include <algorithm>
+#include <stdexcept>
+
+RScriptNameReplacer::RScriptNameReplacer(const colVec & names, const colMap & map)
+{
+	colViews	nameViews,
+				replacements;
+
+	nameViews	.reserve(names.size());
+	replacements.reserve(names.size());
+
+	for(const std::string & name : names)
+	{
+		nameViews	.push_back(name);
+		replacements.push_back(map.at(name));
+	}
+
+	build(nameViews, replacements);
+}
+
+RScriptNameReplacer::RScriptNameReplacer(const colViews & names, const colViews & replacements)
+{
+	build(names, replacements);
+}
+
+RScriptNameReplacer::RScriptNameReplacer(Ptr base, const colViews & changed, const colViews & names, const colViews & replacements)
+	: _base(base)
+{
+	if(_base && _base->_base)
+		throw std::runtime_error("An RScriptNameReplacer can only be built on top of one that was built from scratch!");
+
+	build(names, replacements);
+
+	if(!_base)
+		return;
+
+	_hidden.assign(_base->_names.size(), false);
+
+	for(std::string_view name : changed)
+	{
+		auto index = _base->_index.find(name);
+
+		if(index != _base->_index.end())
+			_hidden[index->second] = true;
+	}
+}
+
+void RScriptNameReplacer::build(const colViews & names, const colViews & replacements)
+{
+	_names			.reserve(names.size());
+	_replacements	.reserve(names.size());
+
+	_index			.reserve(names.size());
+
+	colViews	otherNames;
+
+	for(size_t n = 0; n < names.size(); n++)
+	{
+		std::string_view name = names[n];
+
+		if(!name.empty() && _index.count(name) == 0)
+		{
+			_names			.push_back(std::string(name)); //We reserved enough so the strings in here stay put and _index can point to them
+			_replacements	.push_back(std::string(replacements[n]));
+			_index[_names.back()] = _names.size() - 1;
+
+			if(!std::all_of(name.begin(), name.end(), isNameChar))
+				otherNames.push_back(_names.back());
+		}
+	}
+
+	_otherNames = ColumnNameMatcher(otherNames, otherNames);
+}
+
+bool RScriptNameReplacer::endIsFree(const std::string & script, size_t end, const std::map<size_t, Match> & replaced)
+{
+	//Whatever got replaced already counts as an encoded name, which is all letters, digits and underscores, because that is what it used to be when this was checked.
+	if(replaced.count(end) || (end < script.size() && isNameChar(script[end])))
+		return false;
+
+	//Check for "(" as well because maybe someone has a columnname such as rep or if or something weird like that. This might however have some whitespace in between...
+	for(; end < script.size(); end++)
+		if(replaced.count(end))
+			return true;
+		else if(script[end] == '(')
+			return false;
+		else if(script[end] != '\t' && script[end] != ' ')
+			return true; //Aka something else than whitespace or a brace and that means that we can replace it!
+
+	return true;
+}
+
+void RScriptNameReplacer::namesAt(const std::string & script, size_t pos, std::vector<Match> & found) const
+{
+	static const std::vector<bool> noneHidden;
+
+	ownNamesAt(script, pos, found, noneHidden, 0);
+
+	if(_base)
+		_base->ownNamesAt(script, pos, found, _hidden, _names.size());
+}
+
+void RScriptNameReplacer::ownNamesAt(const std::string & script, size_t pos, std::vector<Match> & found, const std::vector<bool> & hidden, size_t firstIndex) const
+{
+	static thread_local std::vector<Match> others;
+
+	auto isHidden = [&hidden](size_t index) { return index < hidden.size() && hidden[index]; };
+
+	Match match;
+	match.pos = pos;
+
+	//A syntactic name can only be a whole identifier, so we take the identifier and look it up
+	size_t identifierEnd = pos;
+	while(identifierEnd < script.size() && isNameChar(script[identifierEnd]))
+		identifierEnd++;
+
+	if(identifierEnd > pos)
+	{
+		auto lookup = _index.find(std::string_view(script).substr(pos, identifierEnd - pos));
+
+		if(lookup != _index.end() && !isHidden(lookup->second))
+		{
+			match.length	= identifierEnd - pos;
+			match.name		= firstIndex + lookup->second;
+			found.push_back(match);
+		}
+	}
+
+	if(_otherNames.empty())
+		return;
+
+	_otherNames.matchesAt(script, pos, others);
+
+	for(const Match & other : others)
+	{
+		size_t index = _index.at(_otherNames.replacement(other.name));
+
+		if(!isHidden(index))
+		{
+			match.length	= other.length;
+			match.name		= firstIndex + index;
+			found.push_back(match);
+		}
+	}
+}
+
+std::string RScriptNameReplacer::replace(const std::string & script, std::set<std::string> * namesFound) const
+{
+	if(namesFound)
+		namesFound->clear();
+
+	enum class status { R, Backtick, SingleStr, DoubleStr, Comment };
+
+	status				curStatus = status::R;
+	std::vector<Match>	found;
+
+	for(size_t pos = 0; pos < script.size(); pos++)
+	{
+		const char kar = script[pos];
+
+		switch(curStatus)
+		{
+		case status::SingleStr:
+		case status::DoubleStr:
+			if(kar == '\\')
+				pos++; //Skip whatever is escaped
+			else if(kar == (curStatus == status::SingleStr ? '\'' : '"'))
+				curStatus = status::R;
+			continue;
+
+		case status::Comment:
+			if(kar == '\n')
+				curStatus = status::R;
+			continue;
+
+		case status::R:
+		case status::Backtick: //Between backticks can be a name with spaces or quotes, but we replace the names in there just like in the rest of the code
+			//First check if it is a "free columnname" aka is there some space or a kind in front of it. We would not want to replace a part of another term (Imagine what happens when you use a columname such as "E" and a filter that includes the term TRUE, it does not end well..)
+			if(pos == 0 || !isNameChar(script[pos - 1]))
+				namesAt(script, pos, found);
+
+			if(curStatus == status::Backtick)
+			{
+				if		(kar == '\\')	pos++;
+				else if	(kar == '`')	curStatus = status::R;
+			}
+			else switch(kar)
+			{
+			case '\'':	curStatus = status::SingleStr;	break;
+			case '"':	curStatus = status::DoubleStr;	break;
+			case '`':	curStatus = status::Backtick;	break;
+			case '#':	curStatus = status::Comment;	break;
+			}
+
+			//The rest of an identifier cannot be the start of a free name
+			if(isNameChar(kar))
+				while(pos + 1 < script.size() && isNameChar(script[pos + 1]))
+					pos++;
+
+			continue;
+		}
+	}
+
+	//Names can overlap, or touch when they start or end with something like '&', and then replacing one makes the other part of a bigger identifier.
+	//So those are replaced like they used to be, one after the other: longest names first, and each name back to front. Whatever is free at that point gets replaced.
+	//Only names that overlap, touch or have nothing but whitespace in between can change each other's fate, so the rest can be decided on its own.
+	static const std::map<size_t, Match> noneReplaced;
+
+	std::vector<Match>		matches;
+	std::map<size_t, Match>	replaced; ///< By their position
+
+	auto onlyWhitespace = [&script](size_t from, size_t to) { return std::all_of(script.begin() + from, script.begin() + to, [](char kar) { return kar == ' ' || kar == '\t'; }); };
+
+	for(size_t first = 0, last = 0; first < found.size(); first = last)
+	{
+		size_t end = found[first].pos + found[first].length;
+
+		for(last = first + 1; last < found.size() && (found[last].pos <= end || onlyWhitespace(end, found[last].pos)); last++)
+			end = std::max(end, found[last].pos + found[last].length);
+
+		if(last == first + 1)
+		{
+			if(endIsFree(script, end, noneReplaced))
+				matches.push_back(found[first]);
+
+			continue;
+		}
+
+		std::sort(found.begin() + first, found.begin() + last, [](const Match & l, const Match & r)
+		{
+			return l.length != r.length ? l.length > r.length : l.name != r.name ? l.name < r.name : l.pos > r.pos;
+		});
+
+		replaced.clear();
+
+		for(size_t f = first; f < last; f++)
+		{
+			const Match &	match	= found[f];
+			auto			after	= replaced.lower_bound(match.pos);
+
+			//Something replaced right before it makes the start not free, and it cannot be replaced if it overlaps something already replaced either
+			bool	startIsFree	= after == replaced.begin() || std::prev(after)->first + std::prev(after)->second.length < match.pos,
+					overlaps	= after != replaced.end() && after->first < match.pos + match.length;
+
+			if(startIsFree && !overlaps && endIsFree(script, match.pos + match.length, replaced))
+				replaced[match.pos] = match;
+		}
+
+		for(const auto & posMatch : replaced)
+			matches.push_back(posMatch.second);
+	}
+
+	if(namesFound)
+		for(const Match & match : matches)
+			namesFound->insert(name(match.name));
+
+	return ColumnNameMatcher::replaceMatches(script, matches, [&](const Match & match) -> const std::string & { return replacement(match.name); });
+}
+
+RScriptNameReplacer::colVec RScriptNameReplacer::replace(const colVec & scripts, size_t threads) const
+{
+	colVec replaced(scripts.size());
+
+	//More stripes than the pool has threads would only wait for each other
+	threads = std::min({ threads == 0 ? WorkerPool::pool().threads() : threads, WorkerPool::pool().threads(), scripts.size() });
+
+	if(threads <= 1)
+	{
+		for(size_t i = 0; i < scripts.size(); i++)
+			replaced[i] = replace(scripts[i]);
+
+		return replaced;
+	}
+
+	//Every task takes every so-manieth script, scripts tend to be small so splitting them up in blocks might leave one thread with all the big ones.
+	WorkerPool::pool().run(threads, [&](size_t t)
+	{
+		for(size_t i = t; i < scripts.size(); i += threads)
+			replaced[i] = replace(scripts[i]);
+	});
+
+	return replaced;
+}
@@ -0,0 +1,85 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef RSCRIPTNAMEREPLACER_H
+#define RSCRIPTNAMEREPLACER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <memory>
+#include "columnnamematcher.h"
+
+/// Replaces columnNames in R code by something else, for instance their encoded versions.
+/// It goes through the script once, skipping strings (with escapes) and comments, and only replaces "free" names.
+/// That means there is no letter, digit, '.' or '_' right before or after them and they are not followed by a '(', because then it is a function call.
+/// When names overlap or touch the longest is replaced first, and the same name the last first, just like when every name was replaced on its own.
+///
+/// Most columnNames are syntactic R names and then they can only ever match a complete identifier, those are looked up in a hash-index.
+/// The others (with spaces or other weird characters in them, usually written between backticks) are looked for with a ColumnNameMatcher.
+///
+/// Just like ColumnNameMatcher it can be built on top of another one, for when only a couple of names changed.
+class RScriptNameReplacer
+{
+public:
+	typedef std::map<std::string, std::string>			colMap;
+	typedef std::vector<std::string>					colVec;
+	typedef std::vector<std::string_view>				colViews;
+	typedef std::shared_ptr<const RScriptNameReplacer>	Ptr;
+	typedef ColumnNameMatcher::Match					Match;
+
+								RScriptNameReplacer(const colVec & names, const colMap & map);
+								RScriptNameReplacer(const colViews & names, const colViews & replacements); ///< replacements[i] is what names[i] gets replaced by
+
+								///Replaces what base does, except for the names in changed, plus names. Base cannot be built on top of something itself.
+								RScriptNameReplacer(Ptr base, const colViews & changed, const colViews & names, const colViews & replacements);
+								RScriptNameReplacer(const RScriptNameReplacer &)				= delete; ///< _index points into _names
+								RScriptNameReplacer & operator=(const RScriptNameReplacer &)	= delete;
+								RScriptNameReplacer(RScriptNameReplacer &&)					= default; ///< Moving _names keeps its strings where they are, so _index stays valid
+								RScriptNameReplacer & operator=(RScriptNameReplacer &&)		= default;
+
+			std::string			replace(const std::string & script, std::set<std::string> * namesFound = nullptr) const;
+
+			///Replace in a whole bunch of scripts at once, spread over a number of threads of WorkerPool::pool() (0 means all of them).
+			colVec				replace(const colVec & scripts, size_t threads = 1) const;
+
+	static	bool				isNameChar(char kar) { return (kar >= 'a' && kar <= 'z') || (kar >= 'A' && kar <= 'Z') || (kar >= '0' && kar <= '9') || kar == '.' || kar == '_'; }
+
+			size_t				size() const { return _names.size() + (_base ? _base->size() : 0); } ///< Including the hidden names of the base
+
+private:
+			void				namesAt(	const std::string & script, size_t pos, std::vector<Match> & found) const; ///< Every name starting at pos, free or not
+			void				ownNamesAt(	const std::string & script, size_t pos, std::vector<Match> & found, const std::vector<bool> & hidden, size_t firstIndex) const;
+	static	bool				endIsFree(	const std::string & script, size_t end, const std::map<size_t, Match> & replaced);
+			void				build(const colViews & names, const colViews & replacements);
+
+			//The names of _base come after our own
+	const	std::string		&	name(		size_t index) const { return index < _names.size() ? _names[index]			: _base->name(			index - _names.size()); }
+	const	std::string		&	replacement(size_t index) const { return index < _names.size() ? _replacements[index]	: _base->replacement(	index - _names.size()); }
+
+	colVec									_names,
+											_replacements;
+	std::unordered_map<std::string_view, size_t>	_index;			///< Points into _names
+	ColumnNameMatcher						_otherNames;	///< For the non-syntactic names, its replacements are the names themselves
+	Ptr										_base;			///< If set its names are replaced as well, unless they are _hidden
+	std::vector<bool>						_hidden;		///< Names of _base that have changed, by their index there
+};
+
+#endif // RSCRIPTNAMEREPLACER_H
@@ -0,0 +1,156 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "sharedcolumnnames.h"
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+SharedColumnNames::Ptr SharedColumnNames::publish(const std::string & name, std::string_view data, uint64_t version)
+{
+	std::shared_ptr<SharedColumnNames>	shared(new SharedColumnNames(name, false)); //Only the publisher once it actually made the segment
+	const size_t						size = _dataOffset + data.size();
+	void							*	memory;
+
+#ifdef _WIN32
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, DWORD(uint64_t(size) >> 32), DWORD(size & 0xFFFFFFFF), name.c_str());
+
+	if(mapping == NULL || GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		if(mapping != NULL)
+			CloseHandle(mapping);
+
+		throw std::runtime_error("Could not publish columnNames in shared memory '" + name + "'");
+	}
+
+	shared->_mapping = mapping; //The mapping stays as long as someone has a handle to it
+
+	memory = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+
+	if(!memory)
+		throw std::runtime_error("Could not map shared memory '" + name + "'");
+#else
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+	if(fd < 0)
+		throw std::runtime_error("Could not publish columnNames in shared memory '" + name + "'");
+
+	shared->_publisher = true; //So it gets removed again, also if something goes wrong below
+
+	memory = ftruncate(fd, size) == 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+
+	if(memory == MAP_FAILED)
+		throw std::runtime_error("Could not map shared memory '" + name + "'");
+#endif
+
+	shared->_memory	= memory;
+	shared->_size	= size;
+
+	//The data goes in first and the magic last, so an engine that looks too early simply doesn't find it yet
+	Header header;
+	header.magic		= 0;
+	header.headerSize	= sizeof(Header);
+	header.version		= version;
+	header.dataSize		= data.size();
+
+	if(!data.empty())
+		std::memcpy(static_cast<char *>(memory) + _dataOffset, data.data(), data.size());
+
+	std::memcpy(memory, &header, sizeof(Header));
+	static_cast<Header *>(memory)->magic = _magic;
+
+#ifdef _WIN32
+	DWORD previous;
+	VirtualProtect(memory, size, PAGE_READONLY, &previous);
+#else
+	mprotect(memory, size, PROT_READ);
+#endif
+
+	return shared;
+}
+
+SharedColumnNames::Ptr SharedColumnNames::attach(const std::string & name)
+{
+	std::shared_ptr<SharedColumnNames> shared(new SharedColumnNames(name, false));
+
+#ifdef _WIN32
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+
+	if(mapping == NULL)
+		return nullptr;
+
+	shared->_mapping	= mapping;
+	shared->_memory		= MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	MEMORY_BASIC_INFORMATION info;
+
+	if(!shared->_memory || VirtualQuery(shared->_memory, &info, sizeof(info)) == 0)
+		return nullptr;
+
+	shared->_size = info.RegionSize;
+#else
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+
+	if(fd < 0)
+		return nullptr;
+
+	struct stat	info;
+	void	*	memory = fstat(fd, &info) == 0 && size_t(info.st_size) >= _dataOffset ? mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+
+	if(memory == MAP_FAILED)
+		return nullptr;
+
+	shared->_memory	= memory;
+	shared->_size	= info.st_size;
+#endif
+
+	if(shared->_size < _dataOffset || shared->header().magic != _magic || shared->header().headerSize != sizeof(Header) || shared->header().dataSize > shared->_size - _dataOffset)
+		return nullptr;
+
+	return shared;
+}
+
+SharedColumnNames::~SharedColumnNames()
+{
+#ifdef _WIN32
+	if(_memory)		UnmapViewOfFile(_memory);
+	if(_mapping)	CloseHandle(_mapping);
+#else
+	if(_memory)		munmap(_memory, _size);
+	if(_publisher)	shm_unlink(_name.c_str()); //Whoever has it mapped keeps it until they unmap it
+#endif
+}
+
+uint64_t SharedColumnNames::version() const
+{
+	return header().version;
+}
+
+std::string_view SharedColumnNames::data() const
+{
+	return std::string_view(static_cast<const char *>(_memory) + _dataOffset, header().dataSize);
+}
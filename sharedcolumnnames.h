@@ -0,0 +1,71 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef SHAREDCOLUMNNAMES_H
+#define SHAREDCOLUMNNAMES_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstdint>
+
+/// A read-only segment of shared memory holding the serialized names of a ColumnEncoder, so that all engines can use the same copy instead of each building their own.
+/// The desktop publishes one per version of the names, under a new name each time, and tells the engines which to attach to. It is never changed after publishing.
+/// Once the publisher lets go of it the segment is removed, but engines that attached before that can keep using it until they let go as well.
+/// On POSIX systems this is shm_open (so the name should start with a '/'), on Windows a named file mapping.
+class SharedColumnNames
+{
+public:
+	typedef std::shared_ptr<const SharedColumnNames> Ptr;
+
+								SharedColumnNames(const SharedColumnNames &)				= delete;
+								SharedColumnNames & operator=(const SharedColumnNames &)	= delete;
+								~SharedColumnNames();
+
+	static	Ptr					publish(const std::string & name, std::string_view data, uint64_t version); ///< Throws if it cannot be made, for instance because it already exists
+	static	Ptr					attach(const std::string & name); ///< Null if there is no such segment or it doesn't look like one
+
+	const	std::string		&	name()		const { return _name; }
+			uint64_t			version()	const;
+			std::string_view	data()		const;
+
+private:
+								SharedColumnNames(const std::string & name, bool publisher) : _name(name), _publisher(publisher) {}
+
+	struct Header
+	{
+		uint32_t	magic,
+					headerSize;
+		uint64_t	version,
+					dataSize;
+	};
+
+	static const uint32_t		_magic		= 0x4A434E53; //"JCNS"
+	static const size_t			_dataOffset	= 64; ///< Keeps the data aligned, the segment itself starts at a page
+
+	const Header			&	header() const { return *static_cast<const Header *>(_memory); }
+
+	std::string					_name;
+	bool						_publisher;
+	void					*	_memory		= nullptr;
+	size_t						_size		= 0;
+#ifdef _WIN32
+	void					*	_mapping	= nullptr;
+#endif
+};
+
+#endif // SHAREDCOLUMNNAMES_H
@@ -0,0 +1,82 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "sharedpages.h"
+#include <cstring>
+
+void SharedChars::clear()
+{
+	_buffer	.reset();
+	_viewed	.reset();
+	_data	= nullptr;
+	_size	= 0;
+}
+
+void SharedChars::reserve(size_t count)
+{
+	if(!_buffer || _buffer->capacity < count)
+		grow(count);
+}
+
+void SharedChars::append(std::string_view text)
+{
+	//text might be in here, so whatever it is in has to stay around until it is copied
+	std::shared_ptr<Buffer>		buffer	= _buffer;
+	std::shared_ptr<const void>	viewed	= _viewed;
+	size_t						end		= _size;
+
+	//Only one copy can be the one at the end, the others (and those that do not fit anymore) get a buffer of their own
+	if(!_buffer || _buffer->capacity - _size < text.size() || !_buffer->used.compare_exchange_strong(end, _size + text.size()))
+	{
+		grow(std::max(_size + text.size(), 2 * _size));
+		_buffer->used = _size + text.size();
+	}
+
+	if(!text.empty())
+		std::memcpy(_buffer->chars.get() + _size, text.data(), text.size());
+
+	_size += text.size();
+}
+
+void SharedChars::assign(std::string_view text)
+{
+	clear();
+	append(text);
+}
+
+void SharedChars::view(std::string_view text, std::shared_ptr<const void> keepAlive)
+{
+	clear();
+
+	_viewed	= keepAlive;
+	_data	= text.data();
+	_size	= text.size();
+}
+
+void SharedChars::grow(size_t capacity)
+{
+	auto bigger = std::make_shared<Buffer>(std::max(capacity, size_t(256)));
+
+	if(_size > 0)
+		std::memcpy(bigger->chars.get(), _data, _size);
+
+	bigger->used = _size;
+
+	_buffer	= bigger;
+	_data	= bigger->chars.get();
+	_viewed	.reset();
+}
@@ -0,0 +1,220 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef SHAREDPAGES_H
+#define SHAREDPAGES_H
+
+#include <vector>
+#include <string_view>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <iterator>
+#include "binaryserialization.h"
+
+/// An array of plain values split up in pages of 2^pageBits that copies of it share, a page is only copied once one of them changes something in it.
+/// So copying a big table to change a couple of values in it costs a pointer per page plus the pages that actually change, instead of the whole table.
+/// Pages can also point at values kept alive by someone else, shared memory for instance, see view. Those are copied to a page of its own before anything in them changes.
+/// A page that is shared is never written to, so copies can be read from other threads while this one changes, as long as this one isn't read from somewhere else at the same time.
+template<typename T, size_t pageBits = 10>
+class SharedPages
+{
+public:
+	static constexpr size_t pageSize = size_t(1) << pageBits;
+
+	class const_iterator
+	{
+	public:
+		typedef std::forward_iterator_tag	iterator_category;
+		typedef T							value_type;
+		typedef std::ptrdiff_t				difference_type;
+		typedef const T					*	pointer;
+		typedef const T					&	reference;
+
+								const_iterator(const SharedPages & pages, size_t index) : _pages(&pages), _index(index) {}
+
+		const T				&	operator*()										const { return (*_pages)[_index];		}
+		const_iterator		&	operator++()											{ _index++; return *this;			}
+		const_iterator			operator++(int)											{ const_iterator was = *this; _index++; return was; }
+		bool					operator==(const const_iterator & other)		const { return _index == other._index;	}
+		bool					operator!=(const const_iterator & other)		const { return _index != other._index;	}
+
+	private:
+		const SharedPages	*	_pages;
+		size_t					_index;
+	};
+
+			size_t				size()	const { return _size;		}
+			bool				empty()	const { return _size == 0;	}
+			bool				isView() const { return std::any_of(_pages.begin(), _pages.end(), [](const std::shared_ptr<Page> & page) { return bool(page->viewed); }); }
+
+			const T			&	operator[](size_t index)	const { return _data[index >> pageBits][index & mask];	}
+			T				&	edit(size_t index)				  { return writable(index >> pageBits).own[index & mask];	} ///< Copies the page first if it is shared
+
+			const_iterator		begin()	const { return const_iterator(*this, 0);		}
+			const_iterator		end()	const { return const_iterator(*this, _size);	}
+
+			void				clear()
+			{
+				_pages	.clear();
+				_data	.clear();
+				_size = 0;
+			}
+
+			void				reserve(size_t count)
+			{
+				_pages	.reserve(pagesFor(count));
+				_data	.reserve(pagesFor(count));
+			}
+
+			void				push_back(const T & value)
+			{
+				if(_size % pageSize == 0)
+					addPage();
+
+				writable(_pages.size() - 1).own.push_back(value);
+				_size++;
+			}
+
+			void				assign(size_t count, const T & value)
+			{
+				clear();
+
+				for(size_t page = 0; page < pagesFor(count); page++)
+					addPage().own.assign(std::min(pageSize, count - page * pageSize), value);
+
+				_size = count;
+			}
+
+			void				assign(const T * values, size_t count)
+			{
+				clear();
+
+				for(size_t page = 0; page < pagesFor(count); page++)
+					addPage().own.assign(values + page * pageSize, values + std::min(count, (page + 1) * pageSize));
+
+				_size = count;
+			}
+
+			///Points at values instead of copying them, keepAlive has to keep them where they are for as long as it lives.
+			void				view(const T * values, size_t count, std::shared_ptr<const void> keepAlive)
+			{
+				clear();
+
+				for(size_t page = 0; page < pagesFor(count); page++)
+				{
+					auto viewed		= std::make_shared<Page>();
+					viewed->viewed	= keepAlive;
+
+					_pages	.push_back(viewed);
+					_data	.push_back(values + page * pageSize);
+				}
+
+				_size = count;
+			}
+
+			///The same as BinaryWriter::write(values, count) would for all values in one piece.
+			void				write(BinaryWriter & writer) const
+			{
+				writer.startArray<T>(_size);
+
+				for(size_t page = 0; page < _pages.size(); page++)
+					writer.appendToArray(_data[page], pageCount(page));
+			}
+
+private:
+	static constexpr size_t mask = pageSize - 1;
+
+	struct Page
+	{
+		std::vector<T>				own;	///< Always has room for pageSize values, so they never move while it fills up
+		std::shared_ptr<const void>	viewed;	///< If set the values are not in own but wherever that keeps them
+	};
+
+	static	size_t				pagesFor(size_t count)			{ return (count + pageSize - 1) / pageSize;					}
+			size_t				pageCount(size_t page)	const	{ return std::min(pageSize, _size - page * pageSize);	}
+
+			Page			&	addPage()
+			{
+				auto added = std::make_shared<Page>();
+				added->own.reserve(pageSize);
+
+				_pages	.push_back(added);
+				_data	.push_back(added->own.data());
+
+				return *added;
+			}
+
+			Page			&	writable(size_t page)
+			{
+				std::shared_ptr<Page> & current = _pages[page];
+
+				if(current->viewed || current.use_count() > 1)
+				{
+					auto copy = std::make_shared<Page>();
+					copy->own.reserve(pageSize);
+					copy->own.assign(_data[page], _data[page] + pageCount(page));
+
+					current		= copy;
+					_data[page]	= copy->own.data();
+				}
+				else
+					std::atomic_thread_fence(std::memory_order_acquire); //Whoever let go of it last might have been reading it just before
+
+				return *current;
+			}
+
+	std::vector<std::shared_ptr<Page>>	_pages;
+	std::vector<const T *>				_data;	///< Where the values of each page are, so reading doesn't go through the Page
+	size_t								_size = 0;
+};
+
+/// Characters that are only ever appended to, shared by copies the same way: each copy only looks at as many as there were when it was made.
+/// Whichever copy is at the end appends right behind them without copying anything, any other copy (or a view) gets a buffer of its own first.
+/// That way names can be pointed at with a std::string_view just like in a single std::string.
+class SharedChars
+{
+public:
+			std::string_view	chars()		const { return std::string_view(_data, _size);	}
+			size_t				size()		const { return _size;							}
+			bool				isView()	const { return bool(_viewed);					}
+
+			void				clear();
+			void				reserve(size_t count);
+			void				append(std::string_view text);
+			void				assign(std::string_view text);
+			void				view(std::string_view text, std::shared_ptr<const void> keepAlive); ///< See SharedPages::view
+
+private:
+	struct Buffer
+	{
+								Buffer(size_t capacity) : chars(new char[capacity]), capacity(capacity) {}
+
+		std::unique_ptr<char[]>	chars;
+		const size_t			capacity;
+		std::atomic<size_t>		used = 0; ///< By the copy that is at the end
+	};
+
+			void				grow(size_t capacity);
+
+	std::shared_ptr<Buffer>		_buffer;
+	std::shared_ptr<const void>	_viewed;
+	const char				*	_data	= nullptr;
+	size_t						_size	= 0;
+};
+
+#endif // SHAREDPAGES_H
@@ -0,0 +1,46 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef SORTEDCOLUMNNAMES_H
+#define SORTEDCOLUMNNAMES_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+/// Names sorted from big to small, so that smaller columnNames do not bite chunks off of larger ones, sorted once when they are set instead of every time they are asked for.
+class SortedColumnNames
+{
+public:
+	typedef std::vector<std::string>					colVec;
+	typedef std::shared_ptr<const SortedColumnNames>	Ptr;
+
+								SortedColumnNames() {}
+								SortedColumnNames(const SortedColumnNames &)				= delete; ///< It lives in a ColumnEncoderSnapshot and is handed out through a Ptr into that, never as a copy
+								SortedColumnNames & operator=(const SortedColumnNames &)	= delete;
+								SortedColumnNames(SortedColumnNames &&)					= delete;
+								SortedColumnNames & operator=(SortedColumnNames &&)		= delete;
+
+			void				set(colVec names);
+
+			const colVec	&	bigToSmall() const { return _names; }
+
+private:
+	colVec					_names;
+};
+
+#endif // SORTEDCOLUMNNAMES_H
@@ -3,6 +3,7 @@
 
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <sstream>
 #include <algorithm>
@@ -118,27 +119,47 @@ public:
 		return input;
 	}
 
-	inline static std::string escapeHtmlStuff(std::string input, bool doSquareBrackets = false)
+	inline static std::string escapeHtmlStuff(const std::string & input, bool doSquareBrackets = false)
 	{
-		input		= replaceBy(input,	"&", 				"&amp;"	);
-		input		= replaceBy(input,	"<", 				"&lt;"	);
-		input		= replaceBy(input,	">", 				"&gt;"	);
-		input		= replaceBy(input,	"&lt;sub&gt;",		"<sub>"	);
-		input		= replaceBy(input,	"&lt;/sub&gt;",		"</sub>");
-		input		= replaceBy(input,	"&lt;sup&gt;",		"<sup>"	);
-		input		= replaceBy(input,	"&lt;/sup&gt;",		"</sup>");
-		input		= replaceBy(input,	"&lt;b&gt;",		"<b>"	);
-		input		= replaceBy(input,	"&lt;/b&gt;",		"</b>"	);
-		input		= replaceBy(input,	"&lt;i&gt;",		"<i>"	);
-		input		= replaceBy(input,	"&lt;/i&gt;",		"</i>"	);
-		
-		if(doSquareBrackets)
-		{
-			input	= replaceBy(input,	"[", 				"&#x5B;"	);
-			input	= replaceBy(input,	"]", 				"&#x5D;"	);
-		}
+		std::string out;
+		out.reserve(input.size());
 
-		return input;
+		appendEscapedHtml(out, input, doSquareBrackets);
+
+		return out;
+	}
+
+	///Does what escapeHtmlStuff does but appends it to out, going over input only once: & < and > are escaped except for the tags <sub> <sup> <b> and <i> (and their closing ones) which are kept as they are.
+	inline static void appendEscapedHtml(std::string & out, std::string_view input, bool doSquareBrackets = false)
+	{
+		static const std::string_view keptTags[] = { "<sub>", "</sub>", "<sup>", "</sup>", "<b>", "</b>", "<i>", "</i>" };
+
+		for(size_t pos = 0; pos < input.size(); pos++)
+			switch(input[pos])
+			{
+			case '&':	out.append("&amp;");	break;
+			case '>':	out.append("&gt;");		break;
+			case '<':
+			{
+				bool kept = false;
+
+				for(std::string_view tag : keptTags)
+					if(input.compare(pos, tag.size(), tag) == 0)
+					{
+						out.append(tag);
+						pos		+= tag.size() - 1;
+						kept	=  true;
+						break;
+					}
+
+				if(!kept)
+					out.append("&lt;");
+				break;
+			}
+			case '[':	if(doSquareBrackets) out.append("&#x5B;");	else out.push_back('[');	break;
+			case ']':	if(doSquareBrackets) out.append("&#x5D;");	else out.push_back(']');	break;
+			default:	out.push_back(input[pos]);										break;
+			}
 	}
 
 	inline static std::string stripNonAlphaNum(std::string input)
@@ -0,0 +1,108 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "workerpool.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(size_t workers)
+{
+	for(size_t w = 0; w < workers; w++)
+		_workers.emplace_back([this]() { work(); });
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_stop = true;
+	}
+
+	_wake.notify_all();
+
+	for(std::thread & worker : _workers)
+		worker.join();
+}
+
+WorkerPool & WorkerPool::pool()
+{
+	static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+
+	return pool;
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t)> & task)
+{
+	auto job = std::make_shared<Job>(task, count);
+
+	if(count > 1 && !_workers.empty())
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_jobs.push_back(job);
+		_wake.notify_all();
+	}
+
+	doTasks(*job);
+
+	std::unique_lock<std::mutex> lock(_lock);
+	_finished.wait(lock, [&]() { return job->done == job->count; });
+
+	//Every task has been started so no worker looks at it anymore, but it might still be in line and task is about to go away
+	auto inLine = std::find(_jobs.begin(), _jobs.end(), job);
+
+	if(inLine != _jobs.end())
+		_jobs.erase(inLine);
+}
+
+void WorkerPool::doTasks(Job & job)
+{
+	for(size_t task = job.next++; task < job.count; task = job.next++)
+	{
+		job.task(task);
+
+		if(++job.done == job.count)
+		{
+			std::lock_guard<std::mutex> lock(_lock); //So that run cannot miss this between checking and waiting
+			_finished.notify_all();
+		}
+	}
+}
+
+void WorkerPool::work()
+{
+	for(;;)
+	{
+		std::shared_ptr<Job> job;
+
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			_wake.wait(lock, [&]() { return _stop || !_jobs.empty(); });
+
+			if(_stop)
+				return;
+
+			job = _jobs.front();
+
+			if(job->next >= job->count) //Others are busy with the last of its tasks
+			{
+				_jobs.pop_front();
+				continue;
+			}
+		}
+
+		doTasks(*job);
+	}
+}
@@ -0,0 +1,69 @@
+//
+// Copyright (C) 2013-2018 University of Amsterdam
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+/// A couple of threads that are started once and then wait for work, so that splitting up a big text doesn't start (and stop) a bunch of threads every time.
+/// Whoever calls run works along with them, so with one core there are no extra threads at all. Several threads can call run at the same time, their tasks are simply done one job after the other.
+class WorkerPool
+{
+public:
+								WorkerPool(size_t workers);
+								WorkerPool(const WorkerPool &)				= delete;
+								WorkerPool & operator=(const WorkerPool &)	= delete;
+								~WorkerPool();
+
+	static	WorkerPool		&	pool(); ///< The one everyone uses, with a worker for every core but one because the caller of run is busy as well
+
+			size_t				threads() const { return _workers.size() + 1; } ///< Including whoever calls run
+
+			///Calls task(0) up to task(count - 1), spread over the workers and the calling thread, and returns once all are done. task shouldn't throw.
+			void				run(size_t count, const std::function<void(size_t)> & task);
+
+private:
+	struct Job
+	{
+		Job(const std::function<void(size_t)> & task, size_t count) : task(task), count(count) {}
+
+		const std::function<void(size_t)>	&	task;
+		const size_t							count;
+		std::atomic<size_t>						next	= 0,
+												done	= 0;
+	};
+
+			void				work();
+			void				doTasks(Job & job);
+
+	std::vector<std::thread>			_workers;
+	std::deque<std::shared_ptr<Job>>	_jobs;		///< Jobs that might still have tasks left to start
+	std::mutex							_lock;
+	std::condition_variable				_wake,		///< For the workers, when there is a job or they should stop
+										_finished;	///< For whoever waits in run
+	bool								_stop = false;
+};
+
+#endif // WORKERPOOL_H